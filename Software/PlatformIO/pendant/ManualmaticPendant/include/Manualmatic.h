@@ -16,8 +16,6 @@
 #include "Adafruit_GFX.h"
 #include "TouchScreen.h"
 
-#include "EventButton.h"
-
 #include "ManualmaticWiring.h"
 #include "ManualmaticFonts.h"
 #include "ManualmaticUtils.h"
@@ -28,6 +26,8 @@
 #include "ManualmaticControl.h"
 #include "ManualmaticButtonRowKeypad.h"
 #include "ManualmaticOffsetKeypad.h"
+#include "ManualmaticScheduler.h"
+#include "ManualmaticTelemetry.h"
 
 /**
  * @brief The primary Manualmatic Pendant class.
@@ -54,8 +54,8 @@ public:
   void begin();
 
   /**
-   * @brief Called once per loop(), updated each of the 
-   * private members.
+   * @brief Called once per loop(), runs one tick of the 
+   * scheduler which updates each of the private members.
    * 
    */
   void update();
@@ -69,6 +69,8 @@ private:
   ManualmaticButtonRowKeypad brkp;
   ManualmaticOffsetKeypad okp;
   ManualmaticControl control;
+  ManualmaticScheduler scheduler;
+  ManualmaticTelemetry telemetry;
 
 };
 
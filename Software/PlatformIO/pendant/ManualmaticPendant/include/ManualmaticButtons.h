@@ -0,0 +1,143 @@
+/**
+ * @file ManualmaticButtons.h
+ * @author Philip Fletcher <philip.fletcher@stutchbury.com>
+ * @brief All the pendant's buttons, read from one snapshot of the GPIO 
+ * ports and debounced together.
+ * @version 0.1
+ * @date 2022-03-01
+ * 
+ * @copyright Copyright (c) 2022
+ * GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+ * 
+ */
+
+#ifndef ManualmaticButtons_h
+#define ManualmaticButtons_h
+
+#include <Arduino.h>
+
+/**
+ * @brief A button (active low, pulled up). The debounced state is 
+ * provided by ManualmaticButtons and turned into pressed, released, 
+ * click, double click, triple click and long press events.
+ * 
+ * Clicks are counted until the button has been released for 
+ * multiClickMs. If there is no double or triple click handler there 
+ * is nothing to wait for, so the click fires on release.
+ * A press held for longer than the long click duration is not a click.
+ */
+class ManualmaticButton {
+
+  public:
+
+    ManualmaticButton(uint8_t pin);
+
+    uint8_t pin() { return buttonPin; }
+
+    /**
+     * @brief The debounced state
+     */
+    bool isPressed() { return pressed; }
+
+    void setUserId(int16_t id) { uid = id; }
+    int16_t userId() { return uid; }
+
+    void setLongClickDuration(uint16_t ms) { longClickMs = ms; }
+    void setLongPressDuration(uint16_t ms) { longPressMs = ms; }
+
+    void setPressedHandler(std::function<void(ManualmaticButton&)> f) { pressed_cb = f; }
+    void setReleasedHandler(std::function<void(ManualmaticButton&)> f) { released_cb = f; }
+    void setClickHandler(std::function<void(ManualmaticButton&)> f) { click_cb = f; }
+    void setDoubleClickHandler(std::function<void(ManualmaticButton&)> f) { double_click_cb = f; }
+    void setTripleClickHandler(std::function<void(ManualmaticButton&)> f) { triple_click_cb = f; }
+    void setLongPressHandler(std::function<void(ManualmaticButton&)> f) { long_press_cb = f; }
+
+    /**
+     * @brief Called by ManualmaticButtons with the debounced state
+     * 
+     * @return true while there is a timer running (held, or waiting 
+     * for another click) so it must be called even if nothing changes.
+     */
+    bool update(bool isPressed, uint32_t now);
+
+  private:
+
+    uint8_t buttonPin;
+    int16_t uid = 0;
+    bool pressed = false;
+    bool longPressed = false;
+    uint8_t clicks = 0;
+    uint32_t pressedMs = 0;
+    uint32_t releasedMs = 0;
+    uint16_t longClickMs = 750;
+    uint16_t longPressMs = 1000;
+    static const uint16_t multiClickMs = 250;
+
+    std::function<void(ManualmaticButton&)> pressed_cb = NULL;
+    std::function<void(ManualmaticButton&)> released_cb = NULL;
+    std::function<void(ManualmaticButton&)> click_cb = NULL;
+    std::function<void(ManualmaticButton&)> double_click_cb = NULL;
+    std::function<void(ManualmaticButton&)> triple_click_cb = NULL;
+    std::function<void(ManualmaticButton&)> long_press_cb = NULL;
+
+    void fireClicks();
+
+};
+
+/**
+ * @brief Reads every button at once.
+ * 
+ * Each update() reads the input register of each GPIO port in use 
+ * (at most four) and gathers the button bits into one mask. A two bit
+ * vertical counter per button then debounces them all in a handful of 
+ * bitwise operations - a button changes state after four consecutive 
+ * samples agree, so call update() at a quarter of the debounce time.
+ * 
+ * Only buttons that have changed, or have a timer running, are 
+ * passed on to their ManualmaticButton.
+ */
+class ManualmaticButtons {
+
+  public:
+
+    static const uint8_t MAX_BUTTONS = 32;
+
+    /**
+     * @brief Add a button - before begin()
+     */
+    void add(ManualmaticButton& button);
+
+    /**
+     * @brief Configure the pins and find their ports
+     */
+    void begin();
+
+    /**
+     * @brief Snapshot, debounce and fire the button events
+     */
+    void update();
+
+  private:
+
+    static const uint8_t MAX_PORTS = 4;
+
+    ManualmaticButton* buttons[MAX_BUTTONS];
+    uint8_t count = 0;
+
+    volatile uint32_t* ports[MAX_PORTS];
+    uint8_t portCount = 0;
+    uint8_t buttonPort[MAX_BUTTONS];
+    uint32_t buttonMask[MAX_BUTTONS];
+
+    //Debounced state and the vertical counter, one bit per button
+    uint32_t debounced = 0;
+    uint32_t count0 = 0;
+    uint32_t count1 = 0;
+    //Buttons with a timer running
+    uint32_t active = 0;
+
+    uint32_t snapshot();
+
+};
+
+#endif //ManualmaticButtons_h
@@ -53,21 +53,75 @@ class ManualmaticConfig {
 
     float jogVelocityIncrement[2] = {5,25}; //mm/min
 
-
-    uint16_t joystickRateLimit = 10;
-    uint16_t joystickStartBoundary = 50;
-    uint16_t joystickEndBoundary = 50;
-    uint8_t numJoystickIncrements = 8;
+    // Encoder acceleration: {detents per second, step multiplier}, indexed by EncoderCurve_e
+    // Slow turns are always one step per detent, a fast flick sweeps the whole range.
+    EncoderCurvePoint_s encoderCurves[ENCODER_CURVE_COUNT][encoderCurvePoints] = {
+      { {0, 1}, {8, 1}, {30, 4}, {80, 12} },  //CURVE_JOG_VELOCITY
+      { {0, 1}, {8, 1}, {30, 5}, {100, 20} }, //CURVE_FEED_OVERRIDE
+      { {0, 1}, {8, 1}, {30, 5}, {100, 20} }, //CURVE_RAPID_OVERRIDE
+      { {0, 1}, {0, 1}, {0, 1}, {0, 1} },     //CURVE_JOG_INCREMENT
+      { {0, 1}, {10, 1}, {30, 2}, {80, 5} },  //CURVE_SPINDLE_SPEED
+      { {0, 1}, {8, 1}, {30, 5}, {100, 20} }, //CURVE_SPINDLE_OVERRIDE
+      { {0, 1}, {0, 1}, {0, 1}, {0, 1} }      //CURVE_MPG - one increment per detent
+    };
+
+
+    // Tell the host the MPG has stopped after this long without a detent (increment mode)
+    uint16_t mpgIdleMs = 150;
+
+    // MPG velocity mode (toggled by double clicking the modifier button)
+    // Stop the jog if there has been no detent for this long (longer when turning slowly)
+    uint16_t mpgStopTimeoutMs = 100;
+    // Limit the velocity so the axis never travels further than this once the wheel stops
+    float mpgMaxStopDistance = 2; //machine units
+    // Only send a new velocity if it has changed by more than this fraction
+    float mpgVelocityThreshold = 0.05;
+
+    // Joystick - see ManualmaticJoystick.h
+    uint16_t joystickSampleMs = 10;
+    uint8_t joystickOversample = 16; // analogRead()s averaged per sample
+    uint16_t joystickRateLimit = 50; // Minimum ms between velocity changes (stop is always sent)
+    float joystickDeadband = 0.06; // Fraction of full deflection around the centre
+    float joystickEndBoundary = 0.05; // Full speed this close to the end stops
+    float joystickExpo = 0.6; // Response curve: 0 is linear, 1 is cubic (fine control at low deflection)
+    float joystickVelocityThreshold = 0.1; // Only send a new velocity if it has changed by this fraction
+    float joystickMinChange = 0.01; // ...and by at least this fraction of full speed
+    // Holding the modifier jogs both joystick axes with one (coordinated) command
+    bool joystickVectorJog = true;
     Axis_e joystickAxisDefault[2] = {AXIS_X, AXIS_Y};
     Axis_e joystickAxisAlt[2] = {AXIS_A, AXIS_Z};
 
+    // Extrapolate the displayed position between host updates (see ManualmaticState::predictedAbsPos())
+    bool predictiveDro = false;
+    // Don't extrapolate further than this from the last position received
+    uint16_t predictiveDroMaxMs = 250;
+
+    // Overrides and jog velocity changed on the pendant are shown straight away.
+    // Give the host at least this long (or 3 heartbeat round trips) to
+    // confirm the change before putting back its value (see ManualmaticState::checkPendingValues())
+    uint16_t pendingValueMinMs = 100;
+
+    // Time available in each loop for periodic tasks (see ManualmaticScheduler)
+    uint32_t schedulerBudgetUs = 2000;
+
+    // Loop timing telemetry, see ManualmaticTelemetry
+    uint16_t telemetryReportMs = 5000;
+    // A display draw longer than this blocks input for too long
+    uint32_t displayOverrunUs = 20000;
+
     uint16_t errorMessageTimeout = 2000;
     // Display an indicator of the heartbeat
     bool showPulse = true;
+    // Display debug info (heartbeat round trip time)
+    bool showDebug = false;
     
     // It would be so much easier to use 'forceHoming' but this is the LinuxCNC convention
     // [TRAJ] NO_FORCE_HOMING defaults to 0 if not specified in ini file.
     bool noForceHoming = false;
+
+    // Tag frames caused by an input with a trace id and timestamp
+    // Set by [MANUALMATIC] TRACE_LATENCY in the ini file.
+    bool traceLatency = false;
   
 };
 
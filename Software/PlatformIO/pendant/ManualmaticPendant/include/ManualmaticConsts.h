@@ -144,6 +144,8 @@ enum Cmd_e : uint8_t {
   CMD_JOG_VELOCITY = 'j', //Jog Velocity IN/OUT (sorta)
   CMD_JOG_CONTINUOUS = 'N', //Jog continuous (Nudge) payload is velocity
   CMD_JOG_STOP = 'n', //Jog stop (don't nudge)
+  CMD_JOG_IDLE = 'w', //MPG wheel has stopped turning, host stops any jog still queued
+  CMD_JOG_VECTOR = 'V', //Jog two axes continuously together. cmd[1] is first axis, payload is "<axis2>,<vel1>,<vel2>"
   CMD_TASK_MODE = 'M', //mode IN/OUT
   CMD_TASK_STATE = 'E', //task_state (Estop and On/Off) IN/OUT
   CMD_INTERP_STATE = 'I', //interp_state
@@ -162,7 +164,34 @@ enum Cmd_e : uint8_t {
   CMD_EXEC_STATE = 'e', 
   CMD_PROGRAM_STATE = 'p',
   CMD_AUTO = 'a',
-  CMD_HEARTBEAT = 'b' //Heartbeat
+  CMD_HEARTBEAT = 'b', //Heartbeat
+  CMD_TELEMETRY = 'Y', //Loop timing telemetry OUT, cmd[1] is one of Telemetry_e
+  CMD_JOB_RESULT = 'K' //Result of a command that had to wait for LinuxCNC IN, cmd[1] is one of JobResult_e, payload is the command
+};
+
+/**
+ * @brief Valid values for cmd[1] when cmd[0] is CMD_JOB_RESULT
+ */
+enum JobResult_e : uint8_t {
+  JOB_OK = '0',
+  JOB_REJECTED = '1', //LinuxCNC refused the command (or it could not be run)
+  JOB_TIMED_OUT = '2' //LinuxCNC did not finish the command in time
+};
+
+/**
+ * @brief Valid values for cmd[1] when cmd[0] is CMD_TELEMETRY
+ */
+enum Telemetry_e : uint8_t {
+  TELEMETRY_LOOPS = 'n', //Number of loops in the window
+  TELEMETRY_MAX = 'm', //Longest loop period (us)
+  TELEMETRY_P99 = 'p', //99th percentile loop period (us, interpolated within its histogram bucket)
+  TELEMETRY_AVG = 'a', //Mean loop period (us)
+  TELEMETRY_DISPLAY_OVERRUNS = 'd', //Display draws longer than config.displayOverrunUs
+  TELEMETRY_RX_BACKLOG = 'q', //Loops that ended with a frame still waiting to be read
+  TELEMETRY_TASK_LATE = 'l', //name:us of the scheduler task that ran furthest past its due time
+  TELEMETRY_TASK_RUN = 'r', //name:us of the scheduler task with the longest single run
+  TELEMETRY_TASK_MISSED = 'x', //Whole task periods missed
+  TELEMETRY_COMPLETE = '.'
 };
 
 /**
@@ -181,6 +210,7 @@ enum Cmd_ini_e : uint8_t {
   INI_DEFAULT_LINEAR_VELOCITY = 'v',
   INI_MAX_LINEAR_VELOCITY = 'V',
   INI_NO_FORCE_HOMING = 'h',
+  INI_TRACE_LATENCY = 'L',
   INI_COMPLETE = '.'
 };
 
@@ -235,6 +265,33 @@ enum ButtonState_e : uint8_t {
  */
 const unsigned int heartbeatMs = 1000;
 
+/**
+ * @brief Send a heartbeat if nothing else has been sent, or nothing has
+ * been received, for this long. The host echoes it.
+ * 
+ */
+const unsigned int linkIdleMs = 250;
+
+/**
+ * @brief An axis is only taken to have stopped when an update is this
+ * late, however quickly they were arriving
+ * 
+ */
+const unsigned int axisStoppedMinMs = 20;
+
+/**
+ * @brief Disconnect if nothing has been received for this long
+ * 
+ */
+const unsigned int linkTimeoutMs = 750;
+
+/**
+ * @brief A value changed on the pendant is confirmed by the host 
+ * echoing back a value this close to it (sent with 3 decimals)
+ * 
+ */
+const float pendingValueTolerance = 0.0006;
+
 /**
  * @brief Duration of a long click in milliseconds
  * 
@@ -248,15 +305,59 @@ const unsigned int longClickDuration = 700;
 const uint16_t displayRefreshMs = 100; //200
 
 /**
- * @brief Rate limit the MPG to not swamp Serial
+ * @brief The three encoders, used to identify queued encoder events
+ * 
+ */
+enum Encoder_e : uint8_t {
+  ENCODER_FEED, ENCODER_MPG, ENCODER_SPINDLE, ENCODER_COUNT
+};
+
+/**
+ * @brief Quadrature counts per detent of the encoders
+ */
+const int8_t encoderCountsPerDetent = 4;
+
+/**
+ * @brief Each encoder (and mode) has its own acceleration curve
+ * that maps detents per second to a step multiplier.
+ * See ManualmaticConfig::encoderCurves
+ */
+enum EncoderCurve_e : uint8_t {
+  CURVE_JOG_VELOCITY, CURVE_FEED_OVERRIDE, CURVE_RAPID_OVERRIDE, CURVE_JOG_INCREMENT,
+  CURVE_SPINDLE_SPEED, CURVE_SPINDLE_OVERRIDE, CURVE_MPG, ENCODER_CURVE_COUNT
+};
+
+/**
+ * @brief A point on an encoder acceleration curve.
+ * The multiplier is linearly interpolated between points.
+ */
+struct EncoderCurvePoint_s {
+  float velocity; //detents per second
+  float multiplier;
+};
+
+/**
+ * @brief Number of points in each encoder acceleration curve
+ */
+const uint8_t encoderCurvePoints = 4;
+
+/**
+ * @brief Encoder velocity is reset if there is no detent for this long
+ */
+const unsigned long encoderVelocityTimeoutMs = 250;
+
+/**
+ * @brief Throttle MPG messages to not swamp Serial
  */
 const unsigned long mpgRateLimit = 20; //ms
 /**
- * @brief Rate limit the spindle encoder for acceleration
+ * @brief Throttle spindle encoder messages - the host 
+ * needs time to echo the new value back
  */
 const unsigned long spindleRateLimit = 100; //ms
 /**
- * @brief Rate limit the feed encoder for acceleration
+ * @brief Throttle feed encoder messages - the host 
+ * needs time to echo the new value back
  */
 const unsigned long feedRateLimit = 100; //ms
 
@@ -272,6 +373,8 @@ const char G5xLabel[10][6] = { "Tool", "G54", "G55", "G56", "G57", "G85", "G59",
 enum ErrorMessage_e : uint8_t {
     ERRMSG_NONE,
     ERRMSG_NOT_HOMED,
+    ERRMSG_REJECTED,
+    ERRMSG_TIMED_OUT,
 };
 
 #endif //ManualmaticConsts_h
\ No newline at end of file
@@ -14,9 +14,6 @@
 #ifndef ManualmaticControl_h
 #define ManualmaticControl_h
 
-#include <EncoderButton.h>
-#include <EventButton.h>
-#include <EventJoystick.h>
 #include <Bounce2.h>
 #include "ManualmaticWiring.h"
 #include "ManualmaticConsts.h"
@@ -27,6 +24,12 @@
 #include "ManualmaticButtonRowKeypad.h"
 #include "ManualmaticOffsetKeypad.h"
 #include "ManualmaticUtils.h"
+#include "ManualmaticEncoderQueue.h"
+#include "ManualmaticEncoderDynamics.h"
+#include "ManualmaticJoystick.h"
+#include "ManualmaticScheduler.h"
+#include "ManualmaticButtons.h"
+#include "ManualmaticEstop.h"
 
 /**
  * @brief The Manualmatic control class
@@ -60,10 +63,12 @@ class ManualmaticControl {
     void begin();
 
     /**
-     * @brief Called once per loop()
+     * @brief Add the control tasks to the scheduler.
+     * Serial, estop and encoders run every tick, the rest at their own rates.
+     * Buttons are sampled every 2.5ms, debounced over four samples.
      * 
      */
-    void update();
+    void setupTasks(ManualmaticScheduler& scheduler);
 
   private:
 
@@ -75,23 +80,53 @@ class ManualmaticControl {
     ManualmaticMessenger messenger;
 
     //Encoders
-    EncoderButton feed;
-    EncoderButton mpg;
-    EncoderButton spindle;
-
-    EventButton buttonOnOff;
-    EventButton buttonX;
-    EventButton buttonY;
-    EventButton buttonZ;
-    EventButton buttonA;
-    EventButton buttonMode;
-    EventButton buttonModifier;
-    EventButton rowButtons[5];
+    ManualmaticEncoderQueue encoders;
+    ManualmaticButton buttonFeed;
+    ManualmaticButton buttonSpindle;
+
+    ManualmaticEncoderDynamics encoderDynamics[ENCODER_COUNT];
+
+    /**
+     * @brief Steps are accumulated from the first event of a window 
+     * until an event arrives (or the loop runs) a rate limit later.
+     * The window is based on the event timestamps, not the loop.
+     */
+    struct EncoderWindow_s {
+      uint32_t startMicros = 0;
+      int16_t increment = 0;
+      bool pressed = false;
+    };
+    EncoderWindow_s encoderWindows[ENCODER_COUNT];
+    //Don't click or long press after the encoder has been turned while pressed
+    bool feedTurnedWhilePressed = false;
+
+    //Axis last jogged by increment with the MPG, cleared when idle is sent
+    Axis_e mpgJogAxis = AXIS_NONE;
+    unsigned long mpgLastJog = 0;
+
+    //MPG velocity mode
+    Axis_e mpgVelocityAxis = AXIS_NONE;
+    float mpgVelocity = 0; //Target, mm/min
+    float mpgVelocitySent = 0;
+    uint32_t mpgLastDetentMicros = 0;
+    uint32_t mpgStopTimeoutUs = 0;
+    unsigned long mpgLastSent = 0;
+
+    //All the buttons are read and debounced together
+    ManualmaticButtons buttons;
+    ManualmaticButton buttonOnOff;
+    ManualmaticButton buttonX;
+    ManualmaticButton buttonY;
+    ManualmaticButton buttonZ;
+    ManualmaticButton buttonA;
+    ManualmaticButton buttonMode;
+    ManualmaticButton buttonModifier;
+    ManualmaticButton rowButtons[5];
 
     Bounce estopSwitch = Bounce();
 
-    EventJoystick joystick;
-    EventButton buttonJoystick;
+    ManualmaticJoystick joystick;
+    ManualmaticButton buttonJoystick;
 
 
     ButtonRow_e buttonRow = BUTTON_ROW_NONE;
@@ -102,27 +137,72 @@ class ManualmaticControl {
     void setupOffsetKeypad();
     void setupJoystick();
 
+    //Scheduler tasks
+    void updateEstop();
+    void updateSerial();
+    void updateButtons();
+    void updateJoystick();
+    void updateTouch();
+
     void checkEstop(bool force=false);
     void checkHeartbeat();
     void onIniReceived();
 
-    void onFeedEncoder(EncoderButton& rb);
-    void onFeedPressedEncoder(EncoderButton& rb);
-    void onFeedClicked(EncoderButton& rb);
-    void onFeedLongPress(EncoderButton& rb);
+    /**
+     * @brief Read the queued encoder events and call the encoder 
+     * handlers once per rate limit window.
+     */
+    void updateEncoders();
+    void dispatchEncoder(Encoder_e encoder, EncoderWindow_s& w);
+    uint32_t encoderRateLimitUs(Encoder_e encoder);
+    /**
+     * @brief The acceleration curve for an encoder in the current mode
+     */
+    EncoderCurve_e encoderCurve(Encoder_e encoder, bool pressed);
+
+    void onFeedEncoder(int16_t increment);
+    void onFeedPressedEncoder(int16_t increment);
+    void onFeedPressed(ManualmaticButton& btn);
+    void onFeedClicked(ManualmaticButton& btn);
+    void onFeedLongPress(ManualmaticButton& btn);
 
-    void onSpindleEncoder(EncoderButton& rb);
-    void onSpindleClicked(EncoderButton& rb);
-    void onSpindleTripleClicked(EncoderButton& rb);
-    void onSpindleLongPressed(EncoderButton& rb);
+    void onSpindleEncoder(int16_t increment);
+    void onSpindleClicked(ManualmaticButton& btn);
+    void onSpindleTripleClicked(ManualmaticButton& btn);
+    void onSpindleLongPressed(ManualmaticButton& btn);
 
-    void onMpgEncoder(EncoderButton& rb);
+    void onMpgEncoder(int16_t increment);
+    /**
+     * @brief Jog the current axis by MPG increments and note the time
+     * so the host can be told when the wheel stops.
+     */
+    void jogMpgIncrement(int16_t increment);
+    /**
+     * @brief Send CMD_JOG_IDLE once the MPG has been still for config.mpgIdleMs
+     */
+    void checkMpgIdle();
+    /**
+     * @brief In MPG velocity mode, set the target jog velocity from 
+     * the rate of rotation of the wheel.
+     */
+    void onMpgVelocity(const EncoderEvent_s& ev);
+    /**
+     * @brief Send the MPG velocity (throttled) and stop the jog when 
+     * the wheel stops.
+     */
+    void updateMpgVelocity();
+    void stopMpgVelocity();
     
-    void onJoystickXChanged(EventAnalog& ea);
-    void onJoystickYChanged(EventAnalog& ea);
-    void onJoystickIdle(EventJoystick& ejs);
-    void onJoystickClicked(EventButton& ejs);    
-    void onJoystickDoubleClicked(EventButton& ejs);    
+    void onJoystickXChanged(ManualmaticJoystickAxis& ja);
+    void onJoystickYChanged(ManualmaticJoystickAxis& ja);
+    /**
+     * @brief If the modifier is held (and config.joystickVectorJog is set)
+     * send both joystick axes as one vector jog.
+     * @return true if the vector jog was sent.
+     */
+    bool joystickVectorJog();
+    void onJoystickClicked(ManualmaticButton& ejs);    
+    void onJoystickDoubleClicked(ManualmaticButton& ejs);    
 
 
       
@@ -132,8 +212,8 @@ class ManualmaticControl {
     void updateButtonRow();
 
  
-    void onOffClicked(EventButton btn);
-    void onOnOffLongPress(EventButton& btn);
+    void onOffClicked(ManualmaticButton& btn);
+    void onOnOffLongPress(ManualmaticButton& btn);
 
     void setupButtonRow(ButtonRow_e);
 
@@ -147,22 +227,22 @@ class ManualmaticControl {
     /**
      * We're not just toggling the axis, but issuing a JOG_STOP if deselecting
      */
-    void toggleXSelected(EventButton& btn);
-    void toggleYSelected(EventButton& btn);
-    void toggleZSelected(EventButton& btn);
-    void toggleASelected(EventButton& btn);
+    void toggleXSelected(ManualmaticButton& btn);
+    void toggleYSelected(ManualmaticButton& btn);
+    void toggleZSelected(ManualmaticButton& btn);
+    void toggleASelected(ManualmaticButton& btn);
   
-    void toggleDisplayAbsG5x(EventButton& btn);
-    void displayDtg(EventButton& btn);
-    void onButtonALongPressed(EventButton& rb);
-    void toggleDisplayAAxis(EventButton& btn);
+    void toggleDisplayAbsG5x(ManualmaticButton& btn);
+    void displayDtg(ManualmaticButton& btn);
+    void onButtonALongPressed(ManualmaticButton& rb);
+    void toggleDisplayAAxis(ManualmaticButton& btn);
 
-    void onButtonModeClicked(EventButton& btn);
+    void onButtonModeClicked(ManualmaticButton& btn);
     /**
      * All the physical buttons on the button row call this 
      * click handler.
      */
-    void onButtonRowButtonClicked(EventButton& btn);
+    void onButtonRowButtonClicked(ManualmaticButton& btn);
     /**
      * One of the five buttons on the button row has been clicked
      * Call the function that matches the set button type and
@@ -177,14 +257,15 @@ class ManualmaticControl {
      * it will decide what to do based on state and the 
      * ButtonRow_e context.
      */
-    void onButtonRowDoubleClicked(EventButton& btn);
+    void onButtonRowDoubleClicked(ManualmaticButton& btn);
 
     void onTouchCancelG5xOffset(TouchKey& tkcb);
 
     void onTouchSetG5xOffset(TouchKey& tkcb);
 
-    void onButtonModifierPressed(EventButton& rb);
-    void onButtonModifierReleased(EventButton& rb);
+    void onButtonModifierPressed(ManualmaticButton& rb);
+    void onButtonModifierReleased(ManualmaticButton& rb);
+    void onButtonModifierDoubleClicked(ManualmaticButton& rb);
 
 
     /**
@@ -53,7 +53,6 @@ class ManualmaticDisplay {
     ManualmaticOffsetKeypad& okp;
     ManualmaticIcons icons;
 
-    uint32_t lastDisplayRefresh = 0;
     bool forceRefresh = false;
 
     const uint16_t displayWidth = 320;
@@ -90,8 +89,10 @@ class ManualmaticDisplay {
       float feedrate = 1;
       float jogVelocity[2] = { 180, 3000 }; //Sent to serial (as mm/min) but does not update gmoccapy
       bool pulseDrawn = false;
+      uint32_t heartbeatRttUs = 0;
       JogRange_e jogVelocityRange = JOG_RANGE_HIGH;
       uint8_t currentJogIncrement = 3;
+      bool mpgVelocityMode = false;
       ButtonRow_e buttonRow = BUTTON_ROW_NONE;
       Task_state_e task_state = STATE_INIT;
       Screen_e screen = SCREEN_INIT;
@@ -186,6 +187,10 @@ class ManualmaticDisplay {
     void drawStopButton();
     
     void drawPulse();
+    /**
+     * Heartbeat round trip time, if config.showDebug
+     */
+    void drawDebug();
 
 
     struct DisplayAreas_s {
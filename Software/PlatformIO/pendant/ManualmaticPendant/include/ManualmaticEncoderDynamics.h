@@ -0,0 +1,68 @@
+/**
+ * @file ManualmaticEncoderDynamics.h
+ * @author Philip Fletcher <philip.fletcher@stutchbury.com>
+ * @brief Velocity based acceleration for the encoders
+ * @version 0.1
+ * @date 2022-03-01
+ * 
+ * @copyright Copyright (c) 2022
+ * GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+ * 
+ */
+
+#ifndef ManualmaticEncoderDynamics_h
+#define ManualmaticEncoderDynamics_h
+
+#include <Arduino.h>
+#include "ManualmaticConsts.h"
+#include "ManualmaticEncoderQueue.h"
+
+/**
+ * @brief Tracks the velocity of one encoder from the timestamps of its
+ * detents and converts each detent into a number of steps using an
+ * acceleration curve.
+ * 
+ * Velocity is reset when the direction changes or there has been no
+ * detent for encoderVelocityTimeoutMs, so the first detent of a slow 
+ * turn is always a single step.
+ */
+class ManualmaticEncoderDynamics {
+
+  public:
+
+    /**
+     * @brief Apply a detent event 
+     * 
+     * @param ev The event from ManualmaticEncoderQueue
+     * @param curve The acceleration curve for the current mode
+     * @return int16_t The number of whole steps (signed) for this detent.
+     * Any fraction is carried over to the next detent.
+     */
+    int16_t update(const EncoderEvent_s& ev, const EncoderCurvePoint_s* curve);
+
+    /**
+     * @brief Forget the current velocity and any carried fraction
+     */
+    void reset();
+
+    /**
+     * @brief The current velocity in detents per second
+     */
+    float velocity() { return currentVelocity; }
+
+    /**
+     * @brief Interpolate the multiplier for a velocity from a curve
+     * of encoderCurvePoints points.
+     */
+    static float multiplier(const EncoderCurvePoint_s* curve, float velocity);
+
+  private:
+
+    uint32_t lastMicros = 0;
+    int8_t lastDirection = 0;
+    float currentVelocity = 0;
+    float remainder = 0;
+
+};
+
+#endif //ManualmaticEncoderDynamics_h
@@ -0,0 +1,91 @@
+/**
+ * @file ManualmaticEncoderQueue.h
+ * @author Philip Fletcher <philip.fletcher@stutchbury.com>
+ * @brief Decodes the feed, MPG and spindle encoders in interrupts and 
+ * queues timestamped detent events for the main loop.
+ * @version 0.1
+ * @date 2022-03-01
+ * 
+ * @copyright Copyright (c) 2022
+ * GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+ * 
+ */
+
+#ifndef ManualmaticEncoderQueue_h
+#define ManualmaticEncoderQueue_h
+
+#include <Arduino.h>
+#include "ManualmaticWiring.h"
+#include "ManualmaticConsts.h"
+
+/**
+ * @brief One detent of one encoder, timestamped when the 
+ * final quadrature edge of the detent was seen.
+ */
+struct EncoderEvent_s {
+  uint32_t micros;
+  Encoder_e encoder;
+  int8_t direction; //+1 or -1
+};
+
+/**
+ * @brief Quadrature edges are decoded in pin change interrupts and 
+ * each completed detent is pushed onto a single producer, single consumer 
+ * ring buffer. The main loop reads the events back with read().
+ * 
+ * The interrupts only ever write the head and the main loop only ever 
+ * writes the tail, so no locking is required. The slots aren't volatile,
+ * so signal fences stop the compiler moving slot accesses across the 
+ * head and tail updates (a single core needs nothing more).
+ * There is only one set of encoder pins, so everything is static.
+ */
+class ManualmaticEncoderQueue {
+
+  public:
+
+    /**
+     * @brief Configure the encoder pins and attach the interrupts
+     * 
+     */
+    static void begin();
+
+    /**
+     * @brief Return true if there are events waiting to be read
+     */
+    static bool available();
+
+    /**
+     * @brief Pop the oldest event off the queue
+     * 
+     * @param ev Populated with the event if one was available
+     * @return false if the queue is empty
+     */
+    static bool read(EncoderEvent_s& ev);
+
+    /**
+     * @brief The number of events dropped because the main loop
+     * didn't read them quickly enough.
+     */
+    static uint32_t overruns() { return overrunCount; }
+
+  private:
+
+    static const uint8_t QUEUE_SIZE = 128; //Must be a power of 2
+    static EncoderEvent_s queue[QUEUE_SIZE];
+    static volatile uint8_t head;
+    static volatile uint8_t tail;
+    static volatile uint32_t overrunCount;
+
+    static const uint8_t pinA[ENCODER_COUNT];
+    static const uint8_t pinB[ENCODER_COUNT];
+    static volatile uint8_t lastAB[ENCODER_COUNT];
+    static volatile int8_t counts[ENCODER_COUNT];
+
+    static void onChange(Encoder_e encoder);
+    static void onFeedChange();
+    static void onMpgChange();
+    static void onSpindleChange();
+
+};
+
+#endif //ManualmaticEncoderQueue_h
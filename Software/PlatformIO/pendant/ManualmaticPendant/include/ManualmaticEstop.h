@@ -0,0 +1,68 @@
+/**
+ * @file ManualmaticEstop.h
+ * @author Philip Fletcher <philip.fletcher@stutchbury.com>
+ * @brief Sends the soft estop frame from the pin interrupt, without 
+ * waiting for the main loop.
+ * @version 0.1
+ * @date 2022-03-01
+ * 
+ * @copyright Copyright (c) 2022
+ * GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+ * 
+ */
+
+#ifndef ManualmaticEstop_h
+#define ManualmaticEstop_h
+
+#include <Arduino.h>
+#include "ManualmaticWiring.h"
+#include "ManualmaticMessage.h"
+
+/**
+ * @brief The rising edge of the soft estop pin (switch pressed) sends 
+ * the estop frame straight from the interrupt with 
+ * ManualmaticMessage::sendEstop().
+ * 
+ * Only one estop is sent until the (debounced) switch is seen released 
+ * by update(). The polled Bounce in ManualmaticControl still owns the 
+ * estop state and the release.
+ * There is only one estop pin, so everything is static.
+ */
+class ManualmaticEstop {
+
+  public:
+
+    /**
+     * @brief Attach the interrupt
+     * 
+     * @param message Used to send the estop frame
+     */
+    static void begin(ManualmaticMessage& message);
+
+    /**
+     * @brief true if the interrupt has sent the estop for this press
+     */
+    static bool sent() { return latched; }
+
+    /**
+     * @brief Allow the next press to be sent once the debounced switch 
+     * is released (and has been for longer than any bounce).
+     * 
+     * @param pressed The debounced state of the switch
+     */
+    static void update(bool pressed);
+
+  private:
+
+    //Ignore edges this soon after the last (contact bounce)
+    static const uint32_t lockoutUs = 50000;
+
+    static ManualmaticMessage* message;
+    static volatile bool latched;
+    static volatile uint32_t lastMicros;
+
+    static void onRising();
+
+};
+
+#endif //ManualmaticEstop_h
@@ -0,0 +1,124 @@
+/**
+ * @file ManualmaticJoystick.h
+ * @author Philip Fletcher <philip.fletcher@stutchbury.com>
+ * @brief A proportional two axis joystick with oversampling, 
+ * calibration, deadband and response curve.
+ * @version 0.1
+ * @date 2022-03-01
+ * 
+ * @copyright Copyright (c) 2022
+ * GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+ * 
+ */
+
+#ifndef ManualmaticJoystick_h
+#define ManualmaticJoystick_h
+
+#include <Arduino.h>
+#include "ManualmaticConfig.h"
+
+/**
+ * @brief One axis of the joystick.
+ * 
+ * Each sample is the average of config.joystickOversample reads (the 
+ * touchscreen needs the default ADC resolution, so this is done in 
+ * software). The sample is normalised against the centre found by 
+ * calibrate() and the extremes seen so far, then the deadband and 
+ * expo curve are applied to give a position from -1 to 1.
+ * 
+ * The changed handler is only called when the position has moved by 
+ * more than config.joystickVelocityThreshold (relative to the last 
+ * reported position), no more often than config.joystickRateLimit. 
+ * A return to centre is always reported immediately.
+ */
+class ManualmaticJoystickAxis {
+
+  public:
+
+    ManualmaticJoystickAxis(uint8_t pin, ManualmaticConfig& config);
+
+    /**
+     * @brief Find the centre. The joystick must be at rest.
+     */
+    void calibrate();
+
+    /**
+     * @brief Read the axis and call the changed handler if required
+     * 
+     * @param fire If false, the axis is read (and extremes tracked) but
+     * the changed handler is not called.
+     */
+    void update(bool fire = true);
+
+    /**
+     * @brief The position after deadband and response curve, -1 to 1
+     */
+    float position() { return currentPosition; }
+
+    /**
+     * @brief The position last passed to the changed handler
+     */
+    float reportedPosition() { return lastReported; }
+
+    /**
+     * @brief Report the current position on the next update()
+     */
+    void invalidate() { stale = true; }
+
+    void setChangedHandler(std::function<void(ManualmaticJoystickAxis&)> f) { changed_cb = f; }
+
+  private:
+
+    uint8_t pin;
+    ManualmaticConfig& config;
+    float centre = 512;
+    float rawMin = 112;
+    float rawMax = 912;
+    float currentPosition = 0;
+    float lastReported = 0;
+    unsigned long lastReportedMs = 0;
+    bool stale = true;
+    std::function<void(ManualmaticJoystickAxis&)> changed_cb = NULL;
+
+    float read();
+    float shape(float n);
+
+};
+
+/**
+ * @brief The joystick - two ManualmaticJoystickAxis.
+ */
+class ManualmaticJoystick {
+
+  public:
+
+    ManualmaticJoystick(uint8_t pinX, uint8_t pinY, ManualmaticConfig& config);
+
+    ManualmaticJoystickAxis x;
+    ManualmaticJoystickAxis y;
+
+    /**
+     * @brief Calibrate the centre of both axes
+     */
+    void begin();
+
+    /**
+     * @brief Sample both axes. Called every config.joystickSampleMs
+     */
+    void update();
+
+    /**
+     * @brief When disabled, the axes are still read (to track the
+     * extremes) but no changed events are fired.
+     */
+    void enable(bool e = true);
+    bool enabled() { return isEnabled; }
+
+  private:
+
+    ManualmaticConfig& config;
+    bool isEnabled = false;
+
+};
+
+#endif //ManualmaticJoystick_h
@@ -16,6 +16,10 @@
  * 
  * All values (including payload) are sent as char
  * 
+ * If tracing is enabled, the first frame sent after markInput() has
+ * '~', a four hex digit trace id and the eight hex digit micros() of 
+ * the input appended to the payload.
+ * 
  * @version 0.1
  * @date 2022-03-01
  * 
@@ -54,6 +58,49 @@ class ManualmaticMessage : public Print {
      */
     bool available(char *cmd, char *payload);
 
+    /**
+     * @brief The number of bytes received but not yet read
+     */
+    int rxBacklog() { return serial.available(); }
+
+    /**
+     * @brief millis() when the last frame was sent
+     */
+    uint32_t lastSent() { return lastSentMillis; }
+
+    /**
+     * @brief false as soon as the host closes the port or the cable is 
+     * pulled (USB CDC DTR). Always true if the line state is not available.
+     */
+    bool connected();
+
+    /**
+     * @brief Enable or disable input tracing
+     */
+    void setTracing(bool enable) { tracing = enable; }
+
+    /**
+     * @brief Tag the next frame sent with a trace id and the time of 
+     * the input that caused it (ignored if tracing is not enabled).
+     * 
+     * @param atMicros micros() when the input happened
+     */
+    void markInput(uint32_t atMicros);
+
+    /**
+     * @brief The input has been handled - don't tag any later frame
+     */
+    void clearInput() { inputMarked = false; }
+
+    /**
+     * @brief Send the estop frame (E1) immediately - called from the 
+     * estop pin interrupt. If a frame is part way through being sent, 
+     * the estop is sent as soon as it has finished.
+     * 
+     * @param atMicros micros() of the press (for the trace)
+     */
+    void sendEstop(uint32_t atMicros);
+
     /**
      * Send message for single char cmd (no payload)
      */
@@ -111,9 +158,25 @@ class ManualmaticMessage : public Print {
     * 
     */
     const char ETX = '\x03';
+    static const uint8_t maxPayload = 30;
+    //Trace added to payload: ~ id(4) micros(8)
+    static const uint8_t traceSize = 13;
     size_t messageSize = 0;
-                      // STX Cmd Payload ETX \0
-    char message[35]; //  1   2   0-30    1   1
+                                  // STX Cmd Payload ETX \0
+    char message[maxPayload + 5]; //  1   2   0-30    1   1
+
+    uint32_t lastSentMillis = 0;
+
+    bool tracing = false;
+    bool inputMarked = false;
+    volatile uint16_t traceId = 0;
+    uint32_t inputMicros = 0;
+
+    //Set while the serial is being written so the interrupt doesn't interleave
+    volatile bool sending = false;
+    volatile bool estopPending = false;
+    volatile uint32_t estopMicros = 0;
+    void writeEstop();
 
     /**
      * Should never be called but need to override Print::write(uint8_t)
@@ -143,6 +206,16 @@ class ManualmaticMessage : public Print {
 
     void startMessage(const char cmd);
 
+    /**
+     * Append the trace to the payload if there is room
+     */
+    void addTrace();
+
+    /**
+     * Write value as hex to p, returns the end
+     */
+    static char* addHex(char* p, uint32_t value, uint8_t digits);
+
 
     /**
      * (S)End the message
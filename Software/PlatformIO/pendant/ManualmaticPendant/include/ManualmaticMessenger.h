@@ -59,6 +59,17 @@ class ManualmaticMessenger {
      */
     void jogAxisStop(uint8_t axis );
 
+    /**
+     * Jog two axes continuously, starting and stopping together
+     * Pass zero to stop an axis
+     */
+    void jogVector(uint8_t axis1, uint8_t axis2, float velocity1, float velocity2 );
+
+    /**
+     * The MPG has stopped turning
+     */
+    void sendJogIdle(uint8_t axis );
+
 
 
     /**
@@ -0,0 +1,97 @@
+/**
+ * @file ManualmaticScheduler.h
+ * @author Philip Fletcher <philip.fletcher@stutchbury.com>
+ * @brief A small cooperative scheduler for the main loop
+ * @version 0.1
+ * @date 2022-03-01
+ * 
+ * @copyright Copyright (c) 2022
+ * GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+ * 
+ */
+
+#ifndef ManualmaticScheduler_h
+#define ManualmaticScheduler_h
+
+#include <Arduino.h>
+
+/**
+ * @brief A named task and its timing statistics
+ */
+struct SchedulerTask_s {
+  const char* name;
+  uint32_t periodUs; //0 runs every tick
+  uint8_t priority; //0 is highest
+  std::function<void()> f;
+  uint32_t lastRunUs;
+  uint32_t maxRunUs; //Longest single run
+  uint32_t maxLatenessUs; //Furthest past its due time when run
+  uint32_t missed; //Number of times a whole period was missed
+};
+
+/**
+ * @brief The worst of the task statistics since they were last taken
+ */
+struct SchedulerStats_s {
+  const char* latestTask; //The periodic task that ran furthest past its due time
+  uint32_t maxLatenessUs;
+  const char* longestTask; //The task with the longest single run
+  uint32_t maxRunUs;
+  uint32_t missed; //Whole periods missed by all tasks
+};
+
+/**
+ * @brief Runs tasks in priority order, once per tick().
+ * 
+ * Tasks with a period of zero run on every tick, whatever the budget.
+ * Periodic tasks run when due, in priority order, until the tick has
+ * used its budget - except that the first periodic task due always runs
+ * so nothing is starved. Anything else that is due waits for the next tick.
+ * 
+ * So the time between runs of an every-tick task (serial, estop, encoders)
+ * is bounded by: the every-tick tasks + the budget + the longest
+ * single periodic task (normally a display draw).
+ */
+class ManualmaticScheduler {
+
+  public:
+
+    static const uint8_t MAX_TASKS = 12;
+
+    /**
+     * @brief Add a task
+     * 
+     * @param name Used for reporting
+     * @param periodUs Run every periodUs microseconds, 0 for every tick
+     * @param priority Lower numbers run first
+     * @param f The task
+     * @return false if there are too many tasks
+     */
+    bool addTask(const char* name, uint32_t periodUs, uint8_t priority, std::function<void()> f);
+
+    /**
+     * @brief Set the time available for periodic tasks in each tick
+     */
+    void setBudget(uint32_t us) { budgetUs = us; }
+
+    /**
+     * @brief Run the due tasks. Call once per loop()
+     */
+    void tick();
+
+    /**
+     * @brief Get the worst task statistics and start them again
+     */
+    void takeStats(SchedulerStats_s& stats);
+
+  private:
+
+    SchedulerTask_s tasks[MAX_TASKS];
+    uint8_t numTasks = 0;
+    uint32_t budgetUs = 2000;
+
+    void run(SchedulerTask_s& t, uint32_t nowUs);
+
+};
+
+#endif //ManualmaticScheduler_h
@@ -61,6 +61,16 @@ class ManualmaticState {
      */
     void setIniValue(char cmd1, char* payload);
 
+    /**
+     * @brief A heartbeat has been received. If it is the echo of the 
+     * last one sent (seq:pendantMicros:hostMicros), update the round 
+     * trip time. The clock offset is only estimated by the host, from 
+     * the rtt sent with the next heartbeat.
+     * 
+     * @param payload 
+     */
+    void onHeartbeat(char* payload);
+
     // /**
     //  * @brief Used by ManualmaticControl
     //  * 
@@ -71,9 +81,13 @@ class ManualmaticState {
     
     // Hold a consistent 'time' for each loop
     uint32_t now = millis();
-    uint32_t lastHeartbeatSent = 0; //0 denotes no heartbeat
-    uint32_t lastHeartbeatReceived = 0; //0 denotes no heartbeat
-    bool pulse = false; //Toggled by send hearbeat
+    uint32_t lastFrameReceived = 0; //Any valid frame is proof of life
+    uint32_t lastPulse = 0;
+    bool pulse = false; //Toggled every heartbeatMs while connected
+    uint16_t heartbeatSeq = 0;
+    uint32_t heartbeatSentMicros = 0;
+    uint32_t heartbeatRttUs = 0; //Smoothed round trip time, 0 until measured
+    uint32_t lastRttUs = 0; //Sent with the next heartbeat so the host can estimate its offset
 
     uint8_t estop_is_activated = digitalRead(SOFT_ESTOP);
     Task_state_e task_state = STATE_INIT;
@@ -90,6 +104,9 @@ class ManualmaticState {
     float g92Offsets[8] = {0, 0, 0, 0, 0, 0, 0, 0};
     float toolOffsets[8] = {0, 0, 0, 0, 0, 0, 0, 0};
     float axisAbsPos[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    uint32_t axisAbsPosMicros[8] = {0, 0, 0, 0, 0, 0, 0, 0}; //When each axisAbsPos was received
+    float axisVelocity[8] = {0, 0, 0, 0, 0, 0, 0, 0}; //Estimated from axisAbsPos samples (units per second)
+    uint32_t axisAbsPosIntervalMicros[8] = {0, 0, 0, 0, 0, 0, 0, 0}; //Between the last two axisAbsPos samples
     float axisDtg[8] = {0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t homed[8] = {0, 0, 0, 0, 0, 0, 0, 0};
     uint8_t all_homed = 0;
@@ -114,6 +131,23 @@ class ManualmaticState {
     //float jogVelocity[2] = { defaultJogVelocity[0], defaultJogVelocity[1] }; //Sent to serial (as mm/min) but does not update gmoccapy
     float jogVelocity[2] = { 180, 3000 }; //Sent to serial (as mm/min) but does not update gmoccapy
     JogRange_e jogVelocityRange = JOG_RANGE_HIGH;
+
+    /**
+     * @brief A value changed by a knob on the pendant (an override or 
+     * the jog velocity) is shown, and incremented from, straight away 
+     * rather than after the host has echoed it back. 
+     */
+    struct PendingValue_s {
+      float hostValue = 0; //Put back if the host doesn't confirm the change
+      uint32_t changedMs = 0;
+      bool pending = false;
+    };
+    PendingValue_s pendingFeedrate;
+    PendingValue_s pendingRapidrate;
+    PendingValue_s pendingSpindleOverride;
+    PendingValue_s pendingJogVelocity[2];
+    //MPG jogs continuously at a velocity following the wheel rather than by increments
+    bool mpgVelocityMode = false;
     //
     Ini_state_e iniState = INI_STATE_DISCONNECTED;
     //
@@ -208,6 +242,50 @@ class ManualmaticState {
 
     void incrementJogIncrement(int16_t incr);
 
+    /**
+     * @brief Show a value changed on the pendant until the host either
+     * confirms it or it times out, see checkPendingValues().
+     * 
+     * @param p The pending state of value
+     * @param value The state member, eg feedrate
+     * @param newValue 
+     */
+    void setPendingValue(PendingValue_s& p, float& value, float newValue);
+
+    /**
+     * @brief Put back the host's value of anything changed on the pendant
+     * that the host has not confirmed within max(3 round trips, 
+     * config.pendingValueMinMs) of the last change - the host clamped
+     * it or the command was lost. Values the host sends meanwhile that
+     * don't match are from before it caught up and are not shown.
+     */
+    void checkPendingValues();
+
+    /**
+     * @brief Set the absolute position of an axis received from the host
+     * and update the estimated velocity of that axis.
+     * 
+     * @param axis 
+     * @param pos 
+     */
+    void setAxisAbsPos(uint8_t axis, float pos);
+
+    /**
+     * @brief The absolute position of an axis, extrapolated from the 
+     * last received position if config.predictiveDro is set.
+     * 
+     * Only extrapolates while the host reports a non-zero current_vel
+     * and for no longer than config.predictiveDroMaxMs after the last
+     * update. An axis that misses its next update (twice the last 
+     * interval between updates) is taken to have stopped, as the host 
+     * only sends positions that change. Each new position from the host 
+     * is used as-is.
+     * 
+     * @param axis 
+     * @return float 
+     */
+    float predictedAbsPos(uint8_t axis);
+
 
     /**
      * Increment the spindle RPM (Manual mode)
@@ -229,6 +307,11 @@ class ManualmaticState {
   private:
     ManualmaticConfig& config;
 
+    void resetRtt();
+
+    void onHostValue(PendingValue_s& p, float& value, float hostValue);
+    void expirePendingValue(PendingValue_s& p, float& value, uint32_t timeoutMs);
+    void clearPendingValues();
 
 
 
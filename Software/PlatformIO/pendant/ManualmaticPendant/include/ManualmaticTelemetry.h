@@ -0,0 +1,87 @@
+/**
+ * @file ManualmaticTelemetry.h
+ * @author Philip Fletcher <philip.fletcher@stutchbury.com>
+ * @brief Loop timing telemetry reported to the host
+ * @version 0.1
+ * @date 2022-03-01
+ * 
+ * @copyright Copyright (c) 2022
+ * GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+ * 
+ */
+
+#ifndef ManualmaticTelemetry_h
+#define ManualmaticTelemetry_h
+
+#include <Arduino.h>
+#include "ManualmaticConsts.h"
+#include "ManualmaticConfig.h"
+#include "ManualmaticState.h"
+#include "ManualmaticMessage.h"
+#include "ManualmaticScheduler.h"
+
+/**
+ * @brief Times each loop() with the ARM cycle counter and keeps a 
+ * log2 histogram of the loop period (bucket n holds periods of 
+ * 2^n to 2^(n+1)-1 microseconds). 
+ * 
+ * Every config.telemetryReportMs the max, p99 and mean of the window, 
+ * the number of display overruns and the number of loops that ended 
+ * with serial data still waiting are sent to the host as CMD_TELEMETRY 
+ * frames, with the worst of the scheduler's task statistics, and the 
+ * window is reset.
+ * 
+ * The window is deliberately tumbling rather than rolling: each report 
+ * covers exactly the loops since the last, so a stall is logged by the
+ * host once and never counted twice. The p99 is interpolated within 
+ * its histogram bucket, assuming periods spread evenly across it.
+ */
+class ManualmaticTelemetry {
+
+  public:
+
+    static const uint8_t HISTOGRAM_BUCKETS = 18; //Up to ~262ms
+
+    ManualmaticTelemetry(ManualmaticMessage& message, ManualmaticConfig& config, ManualmaticState& state, ManualmaticScheduler& scheduler);
+
+    /**
+     * @brief Enable the cycle counter
+     */
+    void begin();
+
+    /**
+     * @brief Call at the end of each loop()
+     */
+    void onLoop();
+
+    /**
+     * @brief Record the duration of a display draw
+     */
+    void onDisplayDraw(uint32_t us);
+
+    /**
+     * @brief Send the telemetry for this window if connected and reset it
+     */
+    void report();
+
+  private:
+
+    ManualmaticMessage& message;
+    ManualmaticConfig& config;
+    ManualmaticState& state;
+    ManualmaticScheduler& scheduler;
+
+    uint32_t lastCycles = 0;
+    uint32_t histogram[HISTOGRAM_BUCKETS];
+    uint32_t loops = 0;
+    uint32_t maxUs = 0;
+    uint64_t totalUs = 0;
+    uint32_t displayOverruns = 0;
+    uint32_t rxBacklogLoops = 0;
+
+    void reset();
+    uint32_t percentileUs(float pct);
+
+};
+
+#endif //ManualmaticTelemetry_h
@@ -8,7 +8,8 @@ Manualmatic::Manualmatic(Stream& stream, Adafruit_GFX& gfx, TouchScreen& ts)
       display(gfx, state, config, brkp, okp), 
       brkp(gfx, ts, state),
       okp(gfx, &FreeSansBold12pt7b, ts, state),
-      control(serialMessage, config, state, brkp, okp)
+      control(serialMessage, config, state, brkp, okp),
+      telemetry(serialMessage, config, state, scheduler)
     {
   }
 
@@ -18,9 +19,18 @@ void Manualmatic::begin() {
   control.begin();
   display.begin();
   state.setScreen(SCREEN_SPLASH);
+  control.setupTasks(scheduler);
+  scheduler.addTask("display", displayRefreshMs * 1000, 10, [&]() { 
+    uint32_t start = micros();
+    display.update(); 
+    telemetry.onDisplayDraw(micros() - start);
+  });
+  scheduler.addTask("telemetry", config.telemetryReportMs * 1000UL, 11, [&]() { telemetry.report(); });
+  scheduler.setBudget(config.schedulerBudgetUs);
+  telemetry.begin();
 }
 
 void Manualmatic::update() {
-  control.update();
-  display.update();
+  scheduler.tick();
+  telemetry.onLoop();
 }
\ No newline at end of file
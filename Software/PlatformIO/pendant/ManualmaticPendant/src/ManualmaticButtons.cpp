@@ -0,0 +1,125 @@
+#include "ManualmaticButtons.h"
+
+/** ********************************************************************** */
+ManualmaticButton::ManualmaticButton(uint8_t pin) : buttonPin(pin) { }
+
+bool ManualmaticButton::update(bool isPressed, uint32_t now) {
+  if ( isPressed != pressed ) {
+    pressed = isPressed;
+    if ( pressed ) {
+      pressedMs = now;
+      longPressed = false;
+      if ( pressed_cb ) {
+        pressed_cb(*this);
+      }
+    } else {
+      if ( released_cb ) {
+        released_cb(*this);
+      }
+      if ( !longPressed && now - pressedMs < longClickMs ) {
+        clicks++;
+        releasedMs = now;
+        if ( !double_click_cb && !triple_click_cb ) {
+          fireClicks();
+        }
+      } else {
+        clicks = 0;
+      }
+    }
+  }
+  if ( pressed ) {
+    if ( !longPressed && long_press_cb && now - pressedMs >= longPressMs ) {
+      longPressed = true;
+      clicks = 0;
+      long_press_cb(*this);
+    }
+    return true;
+  }
+  if ( clicks > 0 && now - releasedMs >= multiClickMs ) {
+    fireClicks();
+  }
+  return clicks > 0;
+}
+
+void ManualmaticButton::fireClicks() {
+  uint8_t n = clicks;
+  clicks = 0;
+  if ( n >= 3 && triple_click_cb ) {
+    triple_click_cb(*this);
+  } else if ( n == 2 && double_click_cb ) {
+    double_click_cb(*this);
+  } else if ( click_cb ) {
+    click_cb(*this);
+  }
+}
+
+/** ********************************************************************** */
+void ManualmaticButtons::add(ManualmaticButton& button) {
+  if ( count < MAX_BUTTONS ) {
+    buttons[count++] = &button;
+  }
+}
+
+void ManualmaticButtons::begin() {
+  for ( uint8_t b = 0; b < count; b++ ) {
+    uint8_t pin = buttons[b]->pin();
+    pinMode(pin, INPUT_PULLUP);
+    volatile uint32_t* reg = portInputRegister(pin);
+    uint8_t p = 0;
+    while ( p < portCount && ports[p] != reg ) {
+      p++;
+    }
+    if ( p == portCount && portCount < MAX_PORTS ) {
+      ports[portCount++] = reg;
+    }
+    buttonPort[b] = p;
+    buttonMask[b] = digitalPinToBitMask(pin);
+  }
+  //Start from the current state rather than debouncing up to it
+  delayMicroseconds(10);
+  debounced = snapshot();
+  count0 = 0;
+  count1 = 0;
+}
+
+/**
+ * One read of each port, then gather the buttons into a mask (pressed = 1)
+ */
+uint32_t ManualmaticButtons::snapshot() {
+  uint32_t portValues[MAX_PORTS];
+  for ( uint8_t p = 0; p < portCount; p++ ) {
+    portValues[p] = *ports[p];
+  }
+  uint32_t sample = 0;
+  for ( uint8_t b = 0; b < count; b++ ) {
+    if ( !(portValues[buttonPort[b]] & buttonMask[b]) ) {
+      sample |= (1UL << b);
+    }
+  }
+  return sample;
+}
+
+void ManualmaticButtons::update() {
+  uint32_t sample = snapshot();
+  //Two bit vertical counter: counts the samples that differ from the 
+  //debounced state, reset whenever a sample agrees.
+  uint32_t delta = sample ^ debounced;
+  count1 = (count1 ^ count0) & delta;
+  count0 = ~count0 & delta;
+  uint32_t changed = delta & ~(count0 | count1);
+  debounced ^= changed;
+
+  uint32_t pending = changed | active;
+  if ( pending == 0 ) {
+    return;
+  }
+  uint32_t now = millis();
+  active = 0;
+  while ( pending ) {
+    uint8_t b = __builtin_ctz(pending);
+    pending &= pending - 1;
+    if ( buttons[b]->update(debounced & (1UL << b), now) ) {
+      active |= (1UL << b);
+    }
+  }
+}
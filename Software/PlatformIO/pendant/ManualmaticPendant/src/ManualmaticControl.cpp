@@ -13,9 +13,8 @@ ManualmaticControl::ManualmaticControl(ManualmaticMessage& serialMessage,
       brkp(brkp),
       okp(okp),
       messenger(serialMessage, config, s), 
-      feed(ENCODER_A_FEED, ENCODER_B_FEED, BUTTON_FEED),
-      mpg(ENCODER_A_MPG, ENCODER_B_MPG),
-      spindle(ENCODER_A_SPINDLE, ENCODER_B_SPINDLE, BUTTON_SPINDLE),
+      buttonFeed(BUTTON_FEED),
+      buttonSpindle(BUTTON_SPINDLE),
       buttonOnOff(BUTTON_ON_OFF),
       buttonX(BUTTON_X),
       buttonY(BUTTON_Y),
@@ -24,30 +23,49 @@ ManualmaticControl::ManualmaticControl(ManualmaticMessage& serialMessage,
       buttonMode(BUTTON_MODE),
       buttonModifier(BUTTON_MODIFIER),
       rowButtons { 
-        EventButton(BUTTON_ROW_0),
-        EventButton(BUTTON_ROW_1),
-        EventButton(BUTTON_ROW_2),
-        EventButton(BUTTON_ROW_3),
-        EventButton(BUTTON_ROW_4)
+        ManualmaticButton(BUTTON_ROW_0),
+        ManualmaticButton(BUTTON_ROW_1),
+        ManualmaticButton(BUTTON_ROW_2),
+        ManualmaticButton(BUTTON_ROW_3),
+        ManualmaticButton(BUTTON_ROW_4)
       },
-      joystick(JOYSTICK_X, JOYSTICK_Y),
+      joystick(JOYSTICK_X, JOYSTICK_Y, config),
       buttonJoystick(BUTTON_JOYSTICK)
 { }
 /** ********************************************************************** */
 void ManualmaticControl::begin() {
   //pinMode(SOFT_ESTOP, INPUT_PULLUP);
   estopSwitch.attach(SOFT_ESTOP, INPUT_PULLUP);
+  if ( config.useSoftEstop ) {
+    ManualmaticEstop::begin(message);
+  }
   setupEncoders();
   setupButtons();
+  buttons.begin();
   setupButtonRowKeypad();
   setupOffsetKeypad();
   setupJoystick();
   checkEstop(true);
 }
 /** ********************************************************************** */
-void ManualmaticControl::update() {
-  checkEstop();
+void ManualmaticControl::setupTasks(ManualmaticScheduler& scheduler) {
+  scheduler.addTask("estop", 0, 0, [&]() { updateEstop(); });
+  scheduler.addTask("serial", 0, 1, [&]() { updateSerial(); });
+  scheduler.addTask("encoders", 0, 2, [&]() { updateEncoders(); });
+  scheduler.addTask("buttons", 2500, 3, [&]() { updateButtons(); });
+  scheduler.addTask("joystick", config.joystickSampleMs * 1000, 4, [&]() { updateJoystick(); });
+  scheduler.addTask("touch", 10000, 5, [&]() { updateTouch(); });
+  scheduler.addTask("heartbeat", 10000, 6, [&]() { checkHeartbeat(); });
+}
+
+void ManualmaticControl::updateEstop() {
   state.now = millis();
+  message.markInput(micros());
+  checkEstop();
+  message.clearInput();
+}
+
+void ManualmaticControl::updateSerial() {
   if ( state.iniState == INI_STATE_RECEIVED ) {
     onIniReceived();
   }
@@ -56,83 +74,179 @@ void ManualmaticControl::update() {
   if ( message.available(cmd, payload)) {
     state.update(cmd, payload);
   }
+  state.checkPendingValues();
   //Check if button row is different to state button row
   if (buttonRow != state.buttonRow) {
     setupButtonRow(state.buttonRow);
     buttonRow = state.buttonRow;
   }
-  mpg.update();
-  feed.update();
-  spindle.update();
-  buttonOnOff.update();
-  buttonX.update();
-  buttonY.update();
-  buttonZ.update();
-  buttonA.update();
-  buttonMode.update();
-  okp.update();  //Do draw() in updateDisplay()
-  brkp.update(); //Ditto
+}
+
+void ManualmaticControl::updateButtons() {
   updateButtonRow();
-  joystick.update();
-  buttonJoystick.update();
-  buttonModifier.update();
+  //Any frame sent by a button handler is traced from this poll
+  message.markInput(micros());
+  buttons.update();
+  message.clearInput();
+}
 
-  checkHeartbeat();  
+void ManualmaticControl::updateJoystick() {
+  message.markInput(micros());
+  joystick.update();
+  message.clearInput();
+}
 
+void ManualmaticControl::updateTouch() {
+  message.markInput(micros());
+  okp.update();  //Do draw() in updateDisplay()
+  brkp.update(); //Ditto
+  message.clearInput();
 }
 /** ********************************************************************** */
 void ManualmaticControl::setupEncoders() {
   //Configure the encoders
-  feed.setRateLimit(feedRateLimit);
-  feed.setEncoderHandler([&](EncoderButton &eb) { onFeedEncoder(eb); } );
-  feed.setEncoderPressedHandler([&](EncoderButton &eb) { onFeedPressedEncoder(eb); } );
-  feed.setClickHandler([&](EncoderButton &eb) { onFeedClicked(eb); } );
-  feed.setLongPressHandler([&](EncoderButton &eb) { onFeedLongPress(eb); } );
+  encoders.begin();
 
-  spindle.setRateLimit(spindleRateLimit);
-  spindle.setEncoderHandler([&](EncoderButton &eb) { onSpindleEncoder(eb); } );
-  spindle.setClickHandler([&](EncoderButton &eb) { onSpindleClicked(eb); } );
-  spindle.setTripleClickHandler([&](EncoderButton &eb) { onSpindleTripleClicked(eb); } );
-  spindle.setLongPressHandler([&](EncoderButton &eb) { onSpindleLongPressed(eb); } );
+  buttonFeed.setPressedHandler([&](ManualmaticButton &btn) { onFeedPressed(btn); } );
+  buttonFeed.setClickHandler([&](ManualmaticButton &btn) { onFeedClicked(btn); } );
+  buttonFeed.setLongPressHandler([&](ManualmaticButton &btn) { onFeedLongPress(btn); } );
 
-  mpg.setRateLimit(mpgRateLimit);
-  mpg.setEncoderHandler([&](EncoderButton &eb) { onMpgEncoder(eb); } );
+  buttonSpindle.setClickHandler([&](ManualmaticButton &btn) { onSpindleClicked(btn); } );
+  buttonSpindle.setTripleClickHandler([&](ManualmaticButton &btn) { onSpindleTripleClicked(btn); } );
+  buttonSpindle.setLongPressHandler([&](ManualmaticButton &btn) { onSpindleLongPressed(btn); } );
+}
+
+void ManualmaticControl::updateEncoders() {
+  EncoderEvent_s ev;
+  while ( encoders.read(ev) ) {
+    EncoderWindow_s& w = encoderWindows[ev.encoder];
+    bool pressed = ev.encoder == ENCODER_FEED && buttonFeed.isPressed();
+    if ( pressed ) {
+      feedTurnedWhilePressed = true;
+    }
+    if ( w.increment != 0 
+        && ( (ev.micros - w.startMicros) >= encoderRateLimitUs(ev.encoder) || w.pressed != pressed ) ) {
+      dispatchEncoder(ev.encoder, w);
+    }
+    if ( w.increment == 0 ) {
+      w.startMicros = ev.micros;
+      w.pressed = pressed;
+    }
+    w.increment += encoderDynamics[ev.encoder].update(ev, config.encoderCurves[encoderCurve(ev.encoder, pressed)]);
+    if ( ev.encoder == ENCODER_MPG && state.mpgVelocityMode ) {
+      w.increment = 0; //Velocity replaces the increments
+      onMpgVelocity(ev);
+    }
+  }
+  updateMpgVelocity();
+  checkMpgIdle();
+  //Close any windows that have expired with no further events
+  uint32_t nowMicros = micros();
+  for ( uint8_t e=0; e<ENCODER_COUNT; e++ ) {
+    EncoderWindow_s& w = encoderWindows[e];
+    if ( w.increment != 0 && (nowMicros - w.startMicros) >= encoderRateLimitUs((Encoder_e)e) ) {
+      dispatchEncoder((Encoder_e)e, w);
+    }
+  }
+}
+
+EncoderCurve_e ManualmaticControl::encoderCurve(Encoder_e encoder, bool pressed) {
+  switch (encoder) {
+    case ENCODER_FEED:
+      if ( pressed ) {
+        return state.isTaskMode(MODE_MANUAL) ? CURVE_JOG_INCREMENT : CURVE_RAPID_OVERRIDE;
+      }
+      return state.isManual() ? CURVE_JOG_VELOCITY : CURVE_FEED_OVERRIDE;
+    case ENCODER_SPINDLE:
+      return state.isManual() ? CURVE_SPINDLE_SPEED : CURVE_SPINDLE_OVERRIDE;
+    default:
+      return CURVE_MPG;
+  }
+}
+
+uint32_t ManualmaticControl::encoderRateLimitUs(Encoder_e encoder) {
+  switch (encoder) {
+    case ENCODER_FEED: return feedRateLimit * 1000;
+    case ENCODER_MPG: return mpgRateLimit * 1000;
+    case ENCODER_SPINDLE: return spindleRateLimit * 1000;
+    default: return 0;
+  }
+}
+
+void ManualmaticControl::dispatchEncoder(Encoder_e encoder, EncoderWindow_s& w) {
+  int16_t increment = w.increment;
+  w.increment = 0;
+  //Trace from the first detent of the window
+  message.markInput(w.startMicros);
+  switch (encoder) {
+    case ENCODER_FEED:
+      if ( w.pressed ) {
+        onFeedPressedEncoder(increment);
+      } else {
+        onFeedEncoder(increment);
+      }
+      break;
+    case ENCODER_MPG:
+      onMpgEncoder(increment);
+      break;
+    case ENCODER_SPINDLE:
+      onSpindleEncoder(increment);
+      break;
+    default:
+      break;
+  }
+  message.clearInput();
 }
 /** ********************************************************************** */
 void ManualmaticControl::setupButtons() {
-  buttonOnOff.setClickHandler([&](EventButton &btn) { onOffClicked(btn); });
-  buttonOnOff.setLongPressHandler([&](EventButton &btn) { onOnOffLongPress(btn); });
+  buttons.add(buttonFeed);
+  buttons.add(buttonSpindle);
+  buttons.add(buttonOnOff);
+  buttons.add(buttonX);
+  buttons.add(buttonY);
+  buttons.add(buttonZ);
+  buttons.add(buttonA);
+  buttons.add(buttonMode);
+  buttons.add(buttonModifier);
+  for ( uint8_t b=0; b<5; b++ ) {
+    buttons.add(rowButtons[b]);
+  }
+  buttons.add(buttonJoystick);
+
+  buttonOnOff.setClickHandler([&](ManualmaticButton &btn) { onOffClicked(btn); });
+  buttonOnOff.setLongPressHandler([&](ManualmaticButton &btn) { onOnOffLongPress(btn); });
   buttonOnOff.setLongClickDuration(longClickDuration);
 
-  buttonX.setClickHandler([&](EventButton &btn) { toggleXSelected(btn); });  
+  buttonX.setClickHandler([&](ManualmaticButton &btn) { toggleXSelected(btn); });  
   buttonX.setLongClickDuration(longClickDuration);
 
-  buttonY.setClickHandler([&](EventButton &btn) { toggleYSelected(btn); });  
+  buttonY.setClickHandler([&](ManualmaticButton &btn) { toggleYSelected(btn); });  
   buttonY.setLongClickDuration(longClickDuration);
   
-  buttonZ.setClickHandler([&](EventButton &btn) { toggleZSelected(btn); });  
+  buttonZ.setClickHandler([&](ManualmaticButton &btn) { toggleZSelected(btn); });  
   buttonZ.setLongClickDuration(longClickDuration);
   
   
-  buttonA.setClickHandler([&](EventButton &btn) { toggleASelected(btn); });  
-  buttonA.setDoubleClickHandler([&](EventButton &btn) { toggleDisplayAbsG5x(btn); });
-  buttonA.setTripleClickHandler([&](EventButton &btn) { displayDtg(btn); });
-  buttonA.setLongPressHandler([&](EventButton &btn) { onButtonALongPressed(btn); });
+  buttonA.setClickHandler([&](ManualmaticButton &btn) { toggleASelected(btn); });  
+  buttonA.setDoubleClickHandler([&](ManualmaticButton &btn) { toggleDisplayAbsG5x(btn); });
+  buttonA.setTripleClickHandler([&](ManualmaticButton &btn) { displayDtg(btn); });
+  buttonA.setLongPressHandler([&](ManualmaticButton &btn) { onButtonALongPressed(btn); });
   buttonA.setLongClickDuration(longClickDuration);
   
-  buttonMode.setClickHandler([&](EventButton &btn) { onButtonModeClicked(btn); });
+  buttonMode.setClickHandler([&](ManualmaticButton &btn) { onButtonModeClicked(btn); });
   buttonMode.setLongClickDuration(longClickDuration);
 
   for ( uint8_t b=0; b<5; b++ ) {
     rowButtons[b].setUserId(BUTTON_NONE);
     rowButtons[b].setLongClickDuration(longClickDuration);
     //Set all buttons in button row to same handler
-    rowButtons[b].setClickHandler([&](EventButton &btn) { onButtonRowButtonClicked(btn); });
-    rowButtons[b].setDoubleClickHandler([&](EventButton &btn) { onButtonRowDoubleClicked(btn); });
+    rowButtons[b].setClickHandler([&](ManualmaticButton &btn) { onButtonRowButtonClicked(btn); });
+    rowButtons[b].setDoubleClickHandler([&](ManualmaticButton &btn) { onButtonRowDoubleClicked(btn); });
   }
 
-  buttonModifier.setPressedHandler([&](EventButton &btn) { onButtonModifierPressed(btn); });
-  buttonModifier.setReleasedHandler([&](EventButton &btn) { onButtonModifierReleased(btn); });
+  buttonModifier.setPressedHandler([&](ManualmaticButton &btn) { onButtonModifierPressed(btn); });
+  buttonModifier.setReleasedHandler([&](ManualmaticButton &btn) { onButtonModifierReleased(btn); });
+  buttonModifier.setDoubleClickHandler([&](ManualmaticButton &btn) { onButtonModifierDoubleClicked(btn); });
 
 
 }
@@ -154,19 +268,14 @@ void ManualmaticControl::setupOffsetKeypad() {
 }
 
 void ManualmaticControl::setupJoystick() {
-  joystick.setRateLimit(config.joystickRateLimit);
-  joystick.x.setStartBoundary(config.joystickStartBoundary);
-  joystick.y.setStartBoundary(config.joystickStartBoundary);
-  joystick.x.setEndBoundary(config.joystickEndBoundary);
-  joystick.y.setEndBoundary(config.joystickEndBoundary);
-  joystick.setNumIncrements(config.numJoystickIncrements);
-  joystick.x.setChangedHandler([&](EventAnalog &js) { onJoystickXChanged(js); });
-  joystick.y.setChangedHandler([&](EventAnalog &js) { onJoystickYChanged(js); });
-  joystick.setIdleHandler([&](EventJoystick &js) { onJoystickIdle(js); });
-  //Disable the joystick but allow callibration (everyone plays with the joystick!)
-  joystick.enable(false, true);
-  buttonJoystick.setClickHandler([&](EventButton &btn) { onJoystickClicked(btn); });
-  buttonJoystick.setDoubleClickHandler([&](EventButton &btn) { onJoystickDoubleClicked(btn); });
+  //Centre is calibrated at startup - don't touch the joystick!
+  joystick.begin();
+  joystick.x.setChangedHandler([&](ManualmaticJoystickAxis &ja) { onJoystickXChanged(ja); });
+  joystick.y.setChangedHandler([&](ManualmaticJoystickAxis &ja) { onJoystickYChanged(ja); });
+  //Disabled, but still tracks the extremes (everyone plays with the joystick!)
+  joystick.enable(false);
+  buttonJoystick.setClickHandler([&](ManualmaticButton &btn) { onJoystickClicked(btn); });
+  buttonJoystick.setDoubleClickHandler([&](ManualmaticButton &btn) { onJoystickDoubleClicked(btn); });
 }
 
 
@@ -178,7 +287,10 @@ void ManualmaticControl::checkEstop(bool force /*=false*/) {
     estopSwitch.update();
     if ( estopSwitch.changed() || force) {
       state.estop_is_activated = estopSwitch.read();
-      messenger.setMachineState(state.estop_is_activated ? STATE_ESTOP : STATE_ESTOP_RESET);
+      //The interrupt has usually beaten us to it
+      if ( force || !state.estop_is_activated || !ManualmaticEstop::sent() ) {
+        messenger.setMachineState(state.estop_is_activated ? STATE_ESTOP : STATE_ESTOP_RESET);
+      }
     //Ensure the screen reflects the state of the local button and linuxcnc
       if ( !state.estop_is_activated 
           && state.isTaskState(STATE_ESTOP_RESET)
@@ -186,6 +298,7 @@ void ManualmaticControl::checkEstop(bool force /*=false*/) {
         state.setScreen(SCREEN_ESTOP_RESET);
       }
     }
+    ManualmaticEstop::update(state.estop_is_activated);
     //Ensure the screen reflects the state of the local button
     if ( state.estop_is_activated && !state.isScreen(SCREEN_ESTOP) ) {
       state.setScreen(SCREEN_ESTOP);
@@ -194,14 +307,26 @@ void ManualmaticControl::checkEstop(bool force /*=false*/) {
 }
 
 void ManualmaticControl::checkHeartbeat() {
-  if ( state.iniState != INI_STATE_DISCONNECTED //heartbeat has been kickstarted
-    && state.now > (state.lastHeartbeatSent + heartbeatMs) ) {
-    messenger.sendHeartbeat();
-    state.lastHeartbeatSent = state.now;
-    state.pulse = !state.pulse;
+  if ( state.iniState == INI_STATE_DISCONNECTED ) { //heartbeat has not been kickstarted
+    return;
   }
-  if ( state.lastHeartbeatReceived != 0 && state.now > state.lastHeartbeatReceived + (heartbeatMs*4) ) {
+  if ( !message.connected() || state.now - state.lastFrameReceived > linkTimeoutMs ) {
     state.onDisconnected();
+    return;
+  }
+  //Any frame is proof of life so only send a heartbeat if either side has
+  //been quiet. The host only echoes, so a host with nothing to say must be
+  //prompted however busy we are (millis() - frames may have been sent since
+  //state.now). Prompt at most once per linkIdleMs while awaiting the echo.
+  bool quiet = millis() - message.lastSent() >= linkIdleMs;
+  bool unheard = state.now - state.lastFrameReceived >= linkIdleMs
+    && micros() - state.heartbeatSentMicros >= linkIdleMs * 1000UL;
+  if ( quiet || unheard ) {
+    messenger.sendHeartbeat();
+  }
+  if ( state.now - state.lastPulse >= heartbeatMs ) {
+    state.lastPulse = state.now;
+    state.pulse = !state.pulse;
   }
 }
 
@@ -210,37 +335,48 @@ void ManualmaticControl::onIniReceived() {
   checkEstop(true);
   //Reset jog defaults
   messenger.resetJogVelocity();
+  message.setTracing(config.traceLatency);
   state.iniState = INI_STATE_SENT;
 }
 
-void ManualmaticControl::onFeedEncoder(EncoderButton& rb) {
+void ManualmaticControl::onFeedEncoder(int16_t increment) {
   if ( !state.isReady() ) {
     return;
   }
   if ( state.isManual() ) {
-    messenger.incrementJogVelocity(rb.increment() * abs(rb.increment())); //Accelerate
+    messenger.incrementJogVelocity(increment);
   } else {
-    messenger.incrementFeedrate(rb.increment() * abs(rb.increment())); //Accelerate
+    messenger.incrementFeedrate(increment);
   }  
 }
 /**
  * 
  */
-void ManualmaticControl::onFeedPressedEncoder(EncoderButton& rb) {
+void ManualmaticControl::onFeedPressedEncoder(int16_t increment) {
   if ( state.task_mode == MODE_MANUAL ) {
-    state.incrementJogIncrement(rb.increment());
+    state.incrementJogIncrement(increment);
   } else {
-    messenger.incrementRapidrate(rb.increment() * abs(rb.increment())); //Accelerate
+    messenger.incrementRapidrate(increment);
   }
 }
 
-void ManualmaticControl::onFeedClicked(EncoderButton& rb) {
+void ManualmaticControl::onFeedPressed(ManualmaticButton& btn) {
+  feedTurnedWhilePressed = false;
+}
+
+void ManualmaticControl::onFeedClicked(ManualmaticButton& btn) {
+  if ( feedTurnedWhilePressed ) {
+    return;
+  }
   if ( state.isReady() && state.isManual() ) {
     messenger.toggleJogRange();
   }
 }
 
-void ManualmaticControl::onFeedLongPress(EncoderButton& rb) {
+void ManualmaticControl::onFeedLongPress(ManualmaticButton& btn) {
+  if ( feedTurnedWhilePressed ) {
+    return;
+  }
   if ( state.isTaskMode(MODE_MANUAL) && state.currentOperation == OPERATION_NONE) {
     messenger.resetJogVelocity();
   } else if ( state.isTaskMode(MODE_AUTO) || state.isTaskMode(MODE_MDI) ) {
@@ -249,23 +385,22 @@ void ManualmaticControl::onFeedLongPress(EncoderButton& rb) {
   }
 }
 
-void ManualmaticControl::onSpindleEncoder(EncoderButton& rb) {
+void ManualmaticControl::onSpindleEncoder(int16_t increment) {
   if ( !state.isReady() ) {
     return;
   }
-  int16_t incr = rb.increment() * abs(rb.increment()); //Accelerate
   if ( state.isManual() ) {
-    state.incrementSpindleSpeed(incr);
+    state.incrementSpindleSpeed(increment);
     if ( state.spindleDirection != 0 ) {
       messenger.sendSpindleSpeed();
     }
   } else {
     //Just the plain override
-    messenger.incrementSpindleOverride(incr);
+    messenger.incrementSpindleOverride(increment);
   }
 }
 
-void ManualmaticControl::onSpindleClicked(EncoderButton& rb) {
+void ManualmaticControl::onSpindleClicked(ManualmaticButton& btn) {
   if ( !state.isReady() ) {
     return;
   }
@@ -287,7 +422,7 @@ void ManualmaticControl::onSpindleClicked(EncoderButton& rb) {
   }
 }
 
-void ManualmaticControl::onSpindleTripleClicked(EncoderButton& rb) {
+void ManualmaticControl::onSpindleTripleClicked(ManualmaticButton& btn) {
   if ( !state.isReady() ) {
     return;
   }
@@ -301,27 +436,104 @@ void ManualmaticControl::onSpindleTripleClicked(EncoderButton& rb) {
 
 
 
-void ManualmaticControl::onSpindleLongPressed(EncoderButton& rb) {
+void ManualmaticControl::onSpindleLongPressed(ManualmaticButton& btn) {
   if ( !state.isReady() ) {
     return;
   }
+  messenger.sendSpindleOverride(); //Defaults to 1, before the reset so it can be put back if the host doesn't confirm it
   state.resetSpindleDefaults();
-  messenger.sendSpindleOverride(); //Defaults to 1
 }
 
 
-void ManualmaticControl::onMpgEncoder(EncoderButton& rb) {
+void ManualmaticControl::onMpgEncoder(int16_t increment) {
   if ( !state.isReady() ) {
     return;
   }
   if ( state.isManual() && state.currentAxis != AXIS_NONE ) {
     if ( state.isScreen(SCREEN_MANUAL) ) {
-      messenger.jogAxis(state.currentAxis, (config.jogIncrements[state.currentJogIncrement] * rb.increment()) );
+      jogMpgIncrement(increment);
     }
   }
 }
 
 
+void ManualmaticControl::jogMpgIncrement(int16_t increment) {
+  if ( mpgJogAxis != AXIS_NONE && mpgJogAxis != state.currentAxis ) {
+    messenger.sendJogIdle(mpgJogAxis);
+  }
+  messenger.jogAxis(state.currentAxis, (config.jogIncrements[state.currentJogIncrement] * increment) );
+  mpgJogAxis = state.currentAxis;
+  mpgLastJog = state.now;
+}
+
+void ManualmaticControl::checkMpgIdle() {
+  if ( mpgJogAxis != AXIS_NONE && state.now - mpgLastJog >= config.mpgIdleMs ) {
+    messenger.sendJogIdle(mpgJogAxis);
+    mpgJogAxis = AXIS_NONE;
+  }
+}
+
+/**
+ * The first detent after the wheel has stopped is a normal increment so 
+ * single clicks are still precise. After that the wheel's velocity 
+ * (detents/sec * jog increment) becomes a continuous jog, limited to the 
+ * current jog velocity and to a velocity that can stop within 
+ * config.mpgMaxStopDistance.
+ */
+void ManualmaticControl::onMpgVelocity(const EncoderEvent_s& ev) {
+  if ( !state.isReady() || !state.isManual() || state.currentAxis == AXIS_NONE || !state.isScreen(SCREEN_MANUAL) ) {
+    return;
+  }
+  if ( mpgVelocityAxis != AXIS_NONE && mpgVelocityAxis != state.currentAxis ) {
+    stopMpgVelocity();
+  }
+  float detentsPerSec = encoderDynamics[ENCODER_MPG].velocity();
+  mpgLastDetentMicros = ev.micros;
+  if ( detentsPerSec == 0 ) {
+    //Starting again or changed direction
+    stopMpgVelocity();
+    jogMpgIncrement(ev.direction);
+    return;
+  }
+  //Allow for a couple of detents to be missed when turning slowly
+  mpgStopTimeoutUs = constrain((uint32_t)(2000000 / detentsPerSec), config.mpgStopTimeoutMs * 1000UL, encoderVelocityTimeoutMs * 1000UL);
+  float maxStopVelocity = config.mpgMaxStopDistance * 60000000.0 / mpgStopTimeoutUs; //mm/min
+  float v = detentsPerSec * config.jogIncrements[state.currentJogIncrement] * 60;
+  v = min(min(v, state.jogVelocity[state.jogVelocityRange]), maxStopVelocity);
+  mpgVelocity = v * ev.direction;
+  mpgVelocityAxis = state.currentAxis;
+}
+
+void ManualmaticControl::updateMpgVelocity() {
+  if ( mpgVelocityAxis == AXIS_NONE ) {
+    return;
+  }
+  if ( (micros() - mpgLastDetentMicros) > mpgStopTimeoutUs || !state.isManual() ) {
+    stopMpgVelocity();
+    return;
+  }
+  if ( state.now - mpgLastSent < mpgRateLimit ) {
+    return;
+  }
+  if ( mpgVelocitySent == 0 
+      || (mpgVelocity > 0) != (mpgVelocitySent > 0)
+      || abs(mpgVelocity - mpgVelocitySent) > abs(mpgVelocitySent) * config.mpgVelocityThreshold ) {
+    messenger.jogAxisContinuous(mpgVelocityAxis, mpgVelocity);
+    mpgVelocitySent = mpgVelocity;
+    mpgLastSent = state.now;
+  }
+}
+
+void ManualmaticControl::stopMpgVelocity() {
+  if ( mpgVelocityAxis != AXIS_NONE && mpgVelocitySent != 0 ) {
+    messenger.jogAxisStop(mpgVelocityAxis);
+  }
+  mpgVelocityAxis = AXIS_NONE;
+  mpgVelocity = 0;
+  mpgVelocitySent = 0;
+  encoderDynamics[ENCODER_MPG].reset();
+}
+
 void ManualmaticControl::onTouchCancelG5xOffset(TouchKey& tkcb) {
   onCancelG5xOffset();
 }
@@ -352,14 +564,11 @@ void ManualmaticControl::updateButtonRow() {
       setRowButtonType(4, BUTTON_PLAY);
     }
   }
-  for ( uint8_t b=0; b<5; b++ ) {
-    rowButtons[b].update();
-  }
 }
 
 
 /** ********************************************************************** */
-void ManualmaticControl::onOffClicked(EventButton btn) {
+void ManualmaticControl::onOffClicked(ManualmaticButton& btn) {
   if ( state.isTaskState(STATE_ESTOP_RESET) || state.isTaskState(STATE_OFF) ) {
     messenger.setMachineState(STATE_ON);
   } else {    
@@ -367,41 +576,41 @@ void ManualmaticControl::onOffClicked(EventButton btn) {
   }
 }
 /** ********************************************************************** */
-void ManualmaticControl::onOnOffLongPress(EventButton& btn) {
+void ManualmaticControl::onOnOffLongPress(ManualmaticButton& btn) {
   if ( state.isTaskState(STATE_ON) ) {
     messenger.setMachineState(STATE_OFF);
   }
 }
 /** ********************************************************************** */
-void ManualmaticControl::toggleXSelected(EventButton& btn) {
+void ManualmaticControl::toggleXSelected(ManualmaticButton& btn) {
   if ( !state.isReady() ) {
     return;
   }
   toggleSelectedAxis(AXIS_X);
 }
 /** ********************************************************************** */
-void ManualmaticControl::toggleYSelected(EventButton& btn) {
+void ManualmaticControl::toggleYSelected(ManualmaticButton& btn) {
   if ( !state.isReady() ) {
     return;
   }
   toggleSelectedAxis(AXIS_Y);
 }
 /** ********************************************************************** */
-void ManualmaticControl::toggleZSelected(EventButton& btn) {
+void ManualmaticControl::toggleZSelected(ManualmaticButton& btn) {
   if ( !state.isReady() ) {
     return;
   }
   toggleSelectedAxis(AXIS_Z);
 }
 /** ********************************************************************** */
-void ManualmaticControl::toggleASelected(EventButton& btn) {
+void ManualmaticControl::toggleASelected(ManualmaticButton& btn) {
   if ( !state.isReady() ) {
     return;
   }
   toggleSelectedAxis(AXIS_A);
 }
 /** ********************************************************************** */
-void ManualmaticControl::toggleDisplayAbsG5x(EventButton& btn) {
+void ManualmaticControl::toggleDisplayAbsG5x(ManualmaticButton& btn) {
   //if ( isScreen(SCREEN_MANUAL) ) {
     if ( state.displayedCoordSystem == DISPLAY_COORDS_DTG ) { //Currently Dtg
       state.displayedCoordSystem = state.prevCoordSystem;
@@ -411,7 +620,7 @@ void ManualmaticControl::toggleDisplayAbsG5x(EventButton& btn) {
   //}
 }
 /** ********************************************************************** */
-void ManualmaticControl::displayDtg(EventButton& btn) {
+void ManualmaticControl::displayDtg(ManualmaticButton& btn) {
   //if ( isScreen(SCREEN_MANUAL) ) {
     if ( state.displayedCoordSystem != DISPLAY_COORDS_DTG ) {
       state.prevCoordSystem = state.displayedCoordSystem;
@@ -436,13 +645,13 @@ void ManualmaticControl::toggleSelectedAxis(Axis_e axis) {
   }
 }
 /** ********************************************************************** */
-void ManualmaticControl::onButtonALongPressed(EventButton& rb) {
+void ManualmaticControl::onButtonALongPressed(ManualmaticButton& rb) {
   //if ( isScreen(SCREEN_MANUAL) ) {
     toggleDisplayAAxis(rb);
   //}
 }
 /** ********************************************************************** */
-void ManualmaticControl::toggleDisplayAAxis(EventButton& btn) {
+void ManualmaticControl::toggleDisplayAAxis(ManualmaticButton& btn) {
   if ( !state.isScreen(SCREEN_OFFSET_KEYPAD) ) { //Don't allow if setting the offset (or we'll clear the currentAxis)
     if ( state.currentAxis == AXIS_A ) {
       state.currentAxis = AXIS_NONE;
@@ -459,7 +668,7 @@ void ManualmaticControl::toggleDisplayAAxis(EventButton& btn) {
   }
 }
 /** ********************************************************************** */
-void ManualmaticControl::onButtonModeClicked(EventButton& btn) {
+void ManualmaticControl::onButtonModeClicked(ManualmaticButton& btn) {
   if ( state.isProgramState(PROGRAM_STATE_STOPPED) || state.isProgramState(PROGRAM_STATE_NONE) ) {
     //uint8_t m = (state.task_mode % 3) + 1; //or (1+x)%3 from 0
     //messenger.sendTaskMode(m);
@@ -473,7 +682,7 @@ void ManualmaticControl::onButtonModeClicked(EventButton& btn) {
   }
 }
 /** ********************************************************************** */
-void ManualmaticControl::onButtonRowButtonClicked(EventButton& btn) {
+void ManualmaticControl::onButtonRowButtonClicked(ManualmaticButton& btn) {
   onButtonRowClicked( static_cast<ButtonType_e>(btn.userId()) );
 }
 /** ********************************************************************** */
@@ -514,7 +723,7 @@ void ManualmaticControl::onButtonRowClicked(ButtonType_e buttonType) {
   }
 }
 /** ********************************************************************** */
-void ManualmaticControl::onButtonRowDoubleClicked(EventButton& btn) {
+void ManualmaticControl::onButtonRowDoubleClicked(ManualmaticButton& btn) {
   switch ( static_cast<ButtonType_e>(btn.userId()) ) {
     case BUTTON_NONE:
       break;
@@ -869,41 +1078,61 @@ void ManualmaticControl::onSetG5xOffset() {
 
 
 
-void ManualmaticControl::onJoystickXChanged(EventAnalog& ea) {
+void ManualmaticControl::onJoystickXChanged(ManualmaticJoystickAxis& ja) {
   if ( !state.isReady() ) {
     return;
   }
   if ( state.isManual() ) {
-    if ( ea.position() == 0  && state.joystickAxis[0] != AXIS_NONE ) { //Always stop
+    if ( joystickVectorJog() ) {
+      return;
+    }
+    if ( ja.position() == 0  && state.joystickAxis[0] != AXIS_NONE ) { //Always stop
       messenger.jogAxisStop(state.joystickAxis[0]);
+      joystick.y.invalidate(); //Y may have been held by the power feed check
     } else if ( state.isScreen(SCREEN_MANUAL) && state.joystickAxis[0] != AXIS_NONE ) {
       if ( joystick.y.position() == 0 || buttonModifier.isPressed()  ) { //Power feed safety check
-        messenger.jogAxisContinuous(state.joystickAxis[0], (state.jogVelocity[state.jogVelocityRange]/config.numJoystickIncrements) * ea.position());
+        messenger.jogAxisContinuous(state.joystickAxis[0], state.jogVelocity[state.jogVelocityRange] * ja.position());
       }
     }
   }
 }
 
-void ManualmaticControl::onJoystickYChanged(EventAnalog& ea) {
+void ManualmaticControl::onJoystickYChanged(ManualmaticJoystickAxis& ja) {
   if ( !state.isReady() ) {
     return;
   }
   if ( state.isManual() ) {
-    if ( ea.position() == 0  && state.joystickAxis[1] != AXIS_NONE ) { //Always stop
+    if ( joystickVectorJog() ) {
+      return;
+    }
+    if ( ja.position() == 0  && state.joystickAxis[1] != AXIS_NONE ) { //Always stop
         messenger.jogAxisStop(state.joystickAxis[1]);
+        joystick.x.invalidate(); //X may have been held by the power feed check
     } else if ( state.isScreen(SCREEN_MANUAL) && state.joystickAxis[1] != AXIS_NONE  ) {
       if ( joystick.x.position() == 0 || buttonModifier.isPressed()  ) { //Power feed safety check
-        messenger.jogAxisContinuous(state.joystickAxis[1], (state.jogVelocity[state.jogVelocityRange]/config.numJoystickIncrements) * ea.position());
+        messenger.jogAxisContinuous(state.joystickAxis[1], state.jogVelocity[state.jogVelocityRange] * ja.position());
       }
     }
   }
 }
 
-void ManualmaticControl::onJoystickIdle(EventJoystick& ejs) {
-    //joystick.enable(false);
+bool ManualmaticControl::joystickVectorJog() {
+  if ( !config.joystickVectorJog 
+      || !buttonModifier.isPressed()
+      || state.joystickAxis[0] == AXIS_NONE 
+      || state.joystickAxis[1] == AXIS_NONE ) {
+    return false;
+  }
+  float v = state.jogVelocity[state.jogVelocityRange];
+  if ( joystick.x.position() == 0 && joystick.y.position() == 0 ) {
+    messenger.jogVector(state.joystickAxis[0], state.joystickAxis[1], 0, 0); //Always stop
+  } else if ( state.isScreen(SCREEN_MANUAL) ) {
+    messenger.jogVector(state.joystickAxis[0], state.joystickAxis[1], v * joystick.x.position(), v * joystick.y.position());
+  }
+  return true;
 }
 
-void ManualmaticControl::onJoystickClicked(EventButton& ejs) {
+void ManualmaticControl::onJoystickClicked(ManualmaticButton& ejs) {
   if ( !state.isReady() || joystick.x.position() != 0 || joystick.y.position() != 0 ) {
     return;
   }
@@ -919,7 +1148,7 @@ void ManualmaticControl::onJoystickClicked(EventButton& ejs) {
   }
 }
 
-void ManualmaticControl::onJoystickDoubleClicked(EventButton& ejs) {
+void ManualmaticControl::onJoystickDoubleClicked(ManualmaticButton& ejs) {
   if ( !state.isReady() || joystick.x.position() != 0 || joystick.y.position() != 0 ) {
     return;
   }
@@ -928,8 +1157,16 @@ void ManualmaticControl::onJoystickDoubleClicked(EventButton& ejs) {
   state.joystickAxis[1] = config.joystickAxisAlt[1];
 }
 
-void ManualmaticControl::onButtonModifierPressed(EventButton& rb) {
+void ManualmaticControl::onButtonModifierPressed(ManualmaticButton& rb) {
+}
+
+void ManualmaticControl::onButtonModifierReleased(ManualmaticButton& rb) {
 }
 
-void ManualmaticControl::onButtonModifierReleased(EventButton& rb) {
+void ManualmaticControl::onButtonModifierDoubleClicked(ManualmaticButton& rb) {
+  if ( !state.isReady() || !state.isManual() ) {
+    return;
+  }
+  stopMpgVelocity();
+  state.mpgVelocityMode = !state.mpgVelocityMode;
 }
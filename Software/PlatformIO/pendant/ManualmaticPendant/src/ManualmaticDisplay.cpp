@@ -49,53 +49,50 @@ void ManualmaticDisplay::begin() {
 
 void ManualmaticDisplay::update(bool forceRefresh /*= false*/) {
 /** ***************************************************************
- * The main display function called once per loop - decides what
- * to display based on actual state vs drawn state.
+ * The main display function, called by the scheduler every 
+ * displayRefreshMs - decides what to display based on actual 
+ * state vs drawn state.
  */
-  if ( state.now > lastDisplayRefresh + displayRefreshMs ) {
-    lastDisplayRefresh = state.now;
-    
-    if ( drawn.task_state != state.task_state ) {
-      forceRefresh = true;
-      drawn.task_state = state.task_state;
-    }
-    if ( drawn.screen != state.screen ) {
-      forceRefresh = true;
-      drawn.screen = state.screen;
-    }
-    if ( drawn.task_mode != state.task_mode) {
-      forceRefresh = true;
-      drawn.task_mode = state.task_mode;
-    }
+  if ( drawn.task_state != state.task_state ) {
+    forceRefresh = true;
+    drawn.task_state = state.task_state;
+  }
+  if ( drawn.screen != state.screen ) {
+    forceRefresh = true;
+    drawn.screen = state.screen;
+  }
+  if ( drawn.task_mode != state.task_mode) {
+    forceRefresh = true;
+    drawn.task_mode = state.task_mode;
+  }
 
-    switch ( state.screen) {
-      case SCREEN_MANUAL:
-        drawScreenManual(forceRefresh);
-        break;
-      case SCREEN_AUTO:
-        drawScreenAuto(forceRefresh);
-        break;
-      case SCREEN_MDI:
-        drawScreenMdi(forceRefresh);
-        break;
-      case SCREEN_OFFSET_KEYPAD:
-        okp.draw();
-        break;
-      case SCREEN_SPLASH:
-        drawScreenSplash(forceRefresh);
-        break;
-      case SCREEN_ESTOP:
-        drawScreenEstopped(forceRefresh);
-        break;
-      case SCREEN_ESTOP_RESET:
-        drawScreenEstopReset(forceRefresh);
-        break;
-      default: //SCREEN_INIT
-        drawScreenSplash(forceRefresh);
-    }
-    drawPulse();
-    state.refreshDisplay = false;
+  switch ( state.screen) {
+    case SCREEN_MANUAL:
+      drawScreenManual(forceRefresh);
+      break;
+    case SCREEN_AUTO:
+      drawScreenAuto(forceRefresh);
+      break;
+    case SCREEN_MDI:
+      drawScreenMdi(forceRefresh);
+      break;
+    case SCREEN_OFFSET_KEYPAD:
+      okp.draw();
+      break;
+    case SCREEN_SPLASH:
+      drawScreenSplash(forceRefresh);
+      break;
+    case SCREEN_ESTOP:
+      drawScreenEstopped(forceRefresh);
+      break;
+    case SCREEN_ESTOP_RESET:
+      drawScreenEstopReset(forceRefresh);
+      break;
+    default: //SCREEN_INIT
+      drawScreenSplash(forceRefresh);
   }
+  drawPulse();
+  state.refreshDisplay = false;
   
 }
 
@@ -203,7 +200,7 @@ void ManualmaticDisplay::drawScreenManual(bool forceRefresh /*= false*/) {
   drawAxisMarkers(forceRefresh);
   drawManualEncoderRow(forceRefresh);
   drawButtonRow(forceRefresh);
-//  drawDebug();
+  drawDebug();
 }
 
 void ManualmaticDisplay::drawScreenAuto(bool forceRefresh /*= false*/) {
@@ -212,7 +209,7 @@ void ManualmaticDisplay::drawScreenAuto(bool forceRefresh /*= false*/) {
   drawModeLabel(forceRefresh);
   drawAutoEncoderRow(forceRefresh);
   drawButtonRow(forceRefresh);
-//  drawDebug();
+  drawDebug();
 }
 
 void ManualmaticDisplay::drawScreenMdi(bool forceRefresh /*= false*/) {
@@ -221,7 +218,7 @@ void ManualmaticDisplay::drawScreenMdi(bool forceRefresh /*= false*/) {
   drawModeLabel(forceRefresh);
   drawAutoEncoderRow(forceRefresh);
   drawButtonRow(forceRefresh);
-//  drawDebug();
+  drawDebug();
 }
 
 void ManualmaticDisplay::drawScreenSplash(bool forceRefresh) {
@@ -368,10 +365,10 @@ void ManualmaticDisplay::drawAxisCoord(uint8_t axis, bool forceRefresh /*= false
 bool ManualmaticDisplay::setDisplayedAxisValue(uint8_t axis) {
   float old = state.displayedAxisValues[axis];
   if ( state.displayedCoordSystem == DISPLAY_COORDS_ABS ) {
-    state.displayedAxisValues[axis] = state.axisAbsPos[axis];
+    state.displayedAxisValues[axis] = state.predictedAbsPos(axis);
   } else if ( state.displayedCoordSystem == DISPLAY_COORDS_G5X ) {
     //Should this calculation move to state?
-    state.displayedAxisValues[axis] = state.axisAbsPos[axis] - state.g5xOffsets[axis] - state.g92Offsets[axis] - state.toolOffsets[axis];
+    state.displayedAxisValues[axis] = state.predictedAbsPos(axis) - state.g5xOffsets[axis] - state.g92Offsets[axis] - state.toolOffsets[axis];
   } else if ( state.displayedCoordSystem == DISPLAY_COORDS_DTG ) {
     state.displayedAxisValues[axis] = state.axisDtg[axis];
   }
@@ -540,19 +537,26 @@ void ManualmaticDisplay::drawSpindleRpm(bool forceRefresh /*= false*/ ) {
 }
 
 void ManualmaticDisplay::drawJogIncrement(bool forceRefresh /*= false*/ ) {
-  if ( forceRefresh || drawn.currentJogIncrement != state.currentJogIncrement ) {
+  if ( forceRefresh 
+       || drawn.currentJogIncrement != state.currentJogIncrement 
+       || drawn.mpgVelocityMode != state.mpgVelocityMode ) {
     uint8_t a = 1;
-    if ( forceRefresh ) {
+    if ( forceRefresh || drawn.mpgVelocityMode != state.mpgVelocityMode ) {
       //gfx.fillRect(areas.encoders[a].x(), areas.encoders[a].y(), areas.encoders[a].w(), areas.encoders[a].h(), BLACK);
-      drawEncoderLabel(a, "Jog Incr");
+      if ( state.mpgVelocityMode ) {
+        drawEncoderLabel(a, "MPG Vel", LIGHTGREEN);
+      } else {
+        drawEncoderLabel(a, "Jog Incr");
+      }
     } else {
       //gfx.fillRect(areas.encoders[a].x(), areas.encoders[a].y+20, areas.encoders[a].w(), areas.encoders[a].h-20, BLACK);
     }
     char buffer[7];
     uint8_t pre = max(3 - state.currentJogIncrement, 1); //Precision
     dtostrf(config.jogIncrements[state.currentJogIncrement], -4, pre, buffer);
-    drawEncoderValue(a, 0, buffer);
+    drawEncoderValue(a, 0, buffer, BLACK, (state.mpgVelocityMode ? LIGHTGREEN : WHITE));
     drawn.currentJogIncrement = state.currentJogIncrement;
+    drawn.mpgVelocityMode = state.mpgVelocityMode;
   }
 }
 
@@ -655,10 +659,17 @@ void ManualmaticDisplay::drawButtonRow(bool forceRefresh /*= false*/) {
       case ERRMSG_NOT_HOMED:
         errmsg = "Not homed";
         break;
+      case ERRMSG_REJECTED:
+        errmsg = "Rejected by LinuxCNC";
+        break;
+      case ERRMSG_TIMED_OUT:
+        errmsg = "LinuxCNC timed out";
+        break;
     }
     if ( errmsg ) {
       brkp.clear();
       drawButtonRowError(errmsg);
+      drawn.heartbeatRttUs = 0; //Wiped, see drawDebug()
     }
     drawn.errorMessage = state.errorMessage;
   }
@@ -667,6 +678,7 @@ void ManualmaticDisplay::drawButtonRow(bool forceRefresh /*= false*/) {
   }
   if ( forceRefresh || drawn.buttonRow != state.buttonRow ) {
     brkp.clear();
+    drawn.heartbeatRttUs = 0; //Wiped, see drawDebug()
     //Draw the configured buttons
     brkp.draw(0);
     //If required, draw any additional text
@@ -766,6 +778,21 @@ void ManualmaticDisplay::drawButtonLine(uint8_t col) {
   gfx.drawFastHLine(areas.buttonLabels[0].x(), areas.buttonLabels[0].y(), displayWidth, WHITE);
 }
 
+void ManualmaticDisplay::drawDebug() {
+  if ( !config.showDebug || drawn.heartbeatRttUs == state.heartbeatRttUs ) {
+    return;
+  }
+  //Small, bottom right of areas.debugRow, next to the pulse. The button
+  //row owns the area, so drawButtonRow() resets drawn whenever it clears it
+  gfx.setFont();
+  gfx.fillRect(displayWidth - 72, areas.debugRow.b() - 9, 62, 9, BLACK);
+  gfx.setCursor(displayWidth - 72, areas.debugRow.b() - 8);
+  gfx.setTextColor(WHITE);
+  gfx.print(state.heartbeatRttUs);
+  gfx.print("us");
+  drawn.heartbeatRttUs = state.heartbeatRttUs;
+}
+
 void ManualmaticDisplay::drawPulse() {
   if ( config.showPulse && drawn.pulseDrawn != state.pulse) {
     Coords_s cp = { 311, 232 };
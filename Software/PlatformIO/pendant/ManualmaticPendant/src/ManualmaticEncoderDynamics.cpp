@@ -0,0 +1,37 @@
+#include "ManualmaticEncoderDynamics.h"
+
+int16_t ManualmaticEncoderDynamics::update(const EncoderEvent_s& ev, const EncoderCurvePoint_s* curve) {
+  uint32_t dt = ev.micros - lastMicros;
+  if ( ev.direction != lastDirection || lastMicros == 0 || dt > encoderVelocityTimeoutMs * 1000 ) {
+    reset();
+  } else if ( dt > 0 ) {
+    float v = 1000000.0 / dt;
+    //Smooth out the odd uneven detent
+    currentVelocity = (currentVelocity == 0) ? v : (currentVelocity + v) / 2;
+  }
+  lastMicros = ev.micros;
+  lastDirection = ev.direction;
+
+  remainder += multiplier(curve, currentVelocity) * ev.direction;
+  int16_t steps = (int16_t)remainder; //Truncates towards zero
+  remainder -= steps;
+  return steps;
+}
+
+void ManualmaticEncoderDynamics::reset() {
+  currentVelocity = 0;
+  remainder = 0;
+}
+
+float ManualmaticEncoderDynamics::multiplier(const EncoderCurvePoint_s* curve, float velocity) {
+  if ( velocity <= curve[0].velocity ) {
+    return curve[0].multiplier;
+  }
+  for ( uint8_t p=1; p<encoderCurvePoints; p++ ) {
+    if ( velocity < curve[p].velocity ) {
+      float span = curve[p].velocity - curve[p-1].velocity;
+      return curve[p-1].multiplier + (curve[p].multiplier - curve[p-1].multiplier) * (velocity - curve[p-1].velocity) / span;
+    }
+  }
+  return curve[encoderCurvePoints-1].multiplier;
+}
@@ -0,0 +1,88 @@
+#include <atomic>
+#include "ManualmaticEncoderQueue.h"
+
+EncoderEvent_s ManualmaticEncoderQueue::queue[QUEUE_SIZE];
+volatile uint8_t ManualmaticEncoderQueue::head = 0;
+volatile uint8_t ManualmaticEncoderQueue::tail = 0;
+volatile uint32_t ManualmaticEncoderQueue::overrunCount = 0;
+
+const uint8_t ManualmaticEncoderQueue::pinA[ENCODER_COUNT] = { ENCODER_A_FEED, ENCODER_A_MPG, ENCODER_A_SPINDLE };
+const uint8_t ManualmaticEncoderQueue::pinB[ENCODER_COUNT] = { ENCODER_B_FEED, ENCODER_B_MPG, ENCODER_B_SPINDLE };
+volatile uint8_t ManualmaticEncoderQueue::lastAB[ENCODER_COUNT] = { 0, 0, 0 };
+volatile int8_t ManualmaticEncoderQueue::counts[ENCODER_COUNT] = { 0, 0, 0 };
+
+/**
+ * Indexed by (previous AB << 2) | current AB. 
+ * Invalid transitions (both pins changed) are ignored.
+ */
+static const int8_t QUADRATURE_TABLE[16] = { 0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0 };
+
+/** ********************************************************************** */
+void ManualmaticEncoderQueue::begin() {
+  for ( uint8_t e=0; e<ENCODER_COUNT; e++ ) {
+    pinMode(pinA[e], INPUT_PULLUP);
+    pinMode(pinB[e], INPUT_PULLUP);
+    lastAB[e] = (digitalReadFast(pinA[e]) << 1) | digitalReadFast(pinB[e]);
+    counts[e] = 0;
+  }
+  attachInterrupt(digitalPinToInterrupt(ENCODER_A_FEED), onFeedChange, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_B_FEED), onFeedChange, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_A_MPG), onMpgChange, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_B_MPG), onMpgChange, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_A_SPINDLE), onSpindleChange, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(ENCODER_B_SPINDLE), onSpindleChange, CHANGE);
+}
+
+bool ManualmaticEncoderQueue::available() {
+  return head != tail;
+}
+
+bool ManualmaticEncoderQueue::read(EncoderEvent_s& ev) {
+  uint8_t t = tail;
+  if ( t == head ) {
+    return false;
+  }
+  //Don't read the slot before the head that published it
+  std::atomic_signal_fence(std::memory_order_acquire);
+  ev = queue[t];
+  //...or hand it back before it has been read
+  std::atomic_signal_fence(std::memory_order_release);
+  tail = (t + 1) & (QUEUE_SIZE - 1);
+  return true;
+}
+
+/** ********************************************************************** */
+FASTRUN void ManualmaticEncoderQueue::onChange(Encoder_e encoder) {
+  uint8_t ab = (digitalReadFast(pinA[encoder]) << 1) | digitalReadFast(pinB[encoder]);
+  int8_t c = counts[encoder] + QUADRATURE_TABLE[(lastAB[encoder] << 2) | ab];
+  lastAB[encoder] = ab;
+  if ( abs(c) < encoderCountsPerDetent ) {
+    counts[encoder] = c;
+    return;
+  }
+  counts[encoder] = 0;
+  uint8_t h = head;
+  uint8_t next = (h + 1) & (QUEUE_SIZE - 1);
+  if ( next == tail ) {
+    overrunCount++;
+    return;
+  }
+  queue[h].micros = micros();
+  queue[h].encoder = encoder;
+  queue[h].direction = c > 0 ? 1 : -1;
+  //The slot must be written before the head publishes it
+  std::atomic_signal_fence(std::memory_order_release);
+  head = next;
+}
+
+FASTRUN void ManualmaticEncoderQueue::onFeedChange() {
+  onChange(ENCODER_FEED);
+}
+
+FASTRUN void ManualmaticEncoderQueue::onMpgChange() {
+  onChange(ENCODER_MPG);
+}
+
+FASTRUN void ManualmaticEncoderQueue::onSpindleChange() {
+  onChange(ENCODER_SPINDLE);
+}
@@ -0,0 +1,34 @@
+#include "ManualmaticEstop.h"
+
+ManualmaticMessage* ManualmaticEstop::message = nullptr;
+volatile bool ManualmaticEstop::latched = false;
+volatile uint32_t ManualmaticEstop::lastMicros = 0;
+
+/** ********************************************************************** */
+void ManualmaticEstop::begin(ManualmaticMessage& msg) {
+  message = &msg;
+  //Already pressed at startup is handled by the polled switch
+  latched = digitalReadFast(SOFT_ESTOP);
+  attachInterrupt(digitalPinToInterrupt(SOFT_ESTOP), onRising, RISING);
+}
+
+void ManualmaticEstop::update(bool pressed) {
+  if ( !pressed && latched && micros() - lastMicros > lockoutUs ) {
+    latched = false;
+  }
+}
+
+/** ********************************************************************** */
+FASTRUN void ManualmaticEstop::onRising() {
+  uint32_t now = micros();
+  if ( latched || now - lastMicros < lockoutUs ) {
+    return;
+  }
+  lastMicros = now;
+  //A glitch rather than a press
+  if ( !digitalReadFast(SOFT_ESTOP) ) {
+    return;
+  }
+  latched = true;
+  message->sendEstop(now);
+}
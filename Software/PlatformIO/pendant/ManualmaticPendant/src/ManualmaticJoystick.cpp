@@ -0,0 +1,89 @@
+#include "ManualmaticJoystick.h"
+
+ManualmaticJoystickAxis::ManualmaticJoystickAxis(uint8_t pin, ManualmaticConfig& config) 
+  : pin(pin), config(config) {
+}
+
+void ManualmaticJoystickAxis::calibrate() {
+  float sum = 0;
+  for ( uint8_t i=0; i<8; i++ ) {
+    sum += read();
+  }
+  centre = sum / 8;
+  //Extremes are widened as they are seen
+  rawMin = centre - 400;
+  rawMax = centre + 400;
+}
+
+float ManualmaticJoystickAxis::read() {
+  uint32_t sum = 0;
+  for ( uint8_t i=0; i<config.joystickOversample; i++ ) {
+    sum += analogRead(pin);
+  }
+  return (float)sum / config.joystickOversample;
+}
+
+/**
+ * Deadband, end boundary then expo
+ */
+float ManualmaticJoystickAxis::shape(float n) {
+  float a = abs(n);
+  if ( a <= config.joystickDeadband ) {
+    return 0;
+  }
+  a = (a - config.joystickDeadband) / (1 - config.joystickDeadband - config.joystickEndBoundary);
+  a = constrain(a, 0, 1);
+  a = (1 - config.joystickExpo) * a + config.joystickExpo * a * a * a;
+  return n < 0 ? -a : a;
+}
+
+void ManualmaticJoystickAxis::update(bool fire /*= true*/) {
+  float raw = read();
+  if ( raw < rawMin ) rawMin = raw;
+  if ( raw > rawMax ) rawMax = raw;
+  float n = raw >= centre ? (raw - centre) / (rawMax - centre) : (raw - centre) / (centre - rawMin);
+  currentPosition = shape(n);
+
+  if ( !fire || changed_cb == NULL ) {
+    return;
+  }
+  bool report = false;
+  if ( currentPosition == 0 ) {
+    report = lastReported != 0; //Always stop
+    stale = false;
+  } else if ( millis() - lastReportedMs >= config.joystickRateLimit ) {
+    float change = abs(currentPosition - lastReported);
+    report = stale
+      || lastReported == 0
+      || (currentPosition > 0) != (lastReported > 0)
+      || ( change > abs(lastReported) * config.joystickVelocityThreshold 
+           && change >= config.joystickMinChange );
+  }
+  if ( report ) {
+    stale = false;
+    lastReported = currentPosition;
+    lastReportedMs = millis();
+    changed_cb(*this);
+  }
+}
+
+/** ********************************************************************** */
+ManualmaticJoystick::ManualmaticJoystick(uint8_t pinX, uint8_t pinY, ManualmaticConfig& config) 
+  : x(pinX, config), y(pinY, config), config(config) {
+}
+
+void ManualmaticJoystick::begin() {
+  x.calibrate();
+  y.calibrate();
+}
+
+void ManualmaticJoystick::update() {
+  x.update(isEnabled);
+  y.update(isEnabled);
+}
+
+void ManualmaticJoystick::enable(bool e /*= true*/) {
+  isEnabled = e;
+  x.invalidate();
+  y.invalidate();
+}
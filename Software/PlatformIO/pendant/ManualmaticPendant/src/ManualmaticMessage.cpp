@@ -20,6 +20,7 @@
  */
 
 #include "ManualmaticMessage.h"
+#include "ManualmaticConsts.h"
 
 
     /** ***************************************************
@@ -220,7 +221,8 @@
        Overrides Print::write(const uint8_t *, size_t)
     */
     size_t ManualmaticMessage::write(const uint8_t *buffer, size_t size) {
-      while (size-- && messageSize < 34) {
+      //Leave room for ETX and \0
+      while (size-- && messageSize < 3 + maxPayload) {
         message[messageSize++] = *buffer++;
       }
       return messageSize; //not really necessary cos we work directly with messageSize
@@ -261,7 +263,85 @@
      * (S)End the message
      */
     void ManualmaticMessage::endMessage() {
+      if ( inputMarked ) {
+        addTrace();
+      }
       message[messageSize++] = ETX;
       message[messageSize] = '\0';
+      sending = true;
       serial.print(message);
+      sending = false;
+      if ( estopPending ) {
+        writeEstop();
+      }
+      lastSentMillis = millis();
+    }
+
+    void ManualmaticMessage::sendEstop(uint32_t atMicros) {
+      estopMicros = atMicros;
+      estopPending = true;
+      if ( !sending ) {
+        writeEstop();
+      }
+    }
+
+    /**
+     * A separate buffer - the main loop may be part way through
+     * building a message.
+     */
+    void ManualmaticMessage::writeEstop() {
+      estopPending = false;
+      char frame[4 + traceSize + 1] = { STX, CMD_TASK_STATE, STATE_ESTOP + '0' };
+      char* p = frame + 3;
+      if ( tracing ) {
+        *p++ = '~';
+        p = addHex(p, ++traceId, 4);
+        p = addHex(p, estopMicros, 8);
+      }
+      *p++ = ETX;
+      *p = '\0';
+      sending = true;
+      serial.print(frame);
+      sending = false;
+    }
+
+    bool ManualmaticMessage::connected() {
+#ifdef TEENSYDUINO
+      return Serial.dtr();
+#else
+      return true;
+#endif
+    }
+
+
+    /**
+     * Tag the next frame with a trace of this input
+     */
+    void ManualmaticMessage::markInput(uint32_t atMicros) {
+      if ( tracing ) {
+        inputMarked = true;
+        inputMicros = atMicros;
+      }
+    }
+
+    /**
+     * Only the first frame after an input is traced
+     */
+    void ManualmaticMessage::addTrace() {
+      inputMarked = false;
+      if ( messageSize + traceSize > 3 + maxPayload ) {
+        return;
+      }
+      message[messageSize++] = '~';
+      char* p = addHex(message + messageSize, ++traceId, 4);
+      p = addHex(p, inputMicros, 8);
+      messageSize = p - message;
+    }
+
+    char* ManualmaticMessage::addHex(char* p, uint32_t value, uint8_t digits) {
+      while ( digits-- ) {
+        uint8_t nibble = (value >> (digits * 4)) & 0x0F;
+        *p++ = nibble < 10 ? '0' + nibble : 'A' + nibble - 10;
+      }
+      return p;
     }
@@ -18,7 +18,16 @@ ManualmaticMessenger::ManualmaticMessenger(ManualmaticMessage& message, Manualma
   {}
 
 void ManualmaticMessenger::ManualmaticMessenger::sendHeartbeat() {
-  serialMessage.send(CMD_HEARTBEAT);
+  //seq:micros:rtt - echoed back with the host's micros to measure the 
+  //round trip. The rtt of the previous exchange (or 0) lets the host 
+  //estimate its clock offset too.
+  state.heartbeatSeq++;
+  state.heartbeatSentMicros = micros();
+  char payload[30];
+  snprintf(payload, sizeof(payload), "%u:%lu:%lu", state.heartbeatSeq, 
+    (unsigned long)state.heartbeatSentMicros, (unsigned long)state.lastRttUs);
+  state.lastRttUs = 0;
+  serialMessage.send(CMD_HEARTBEAT, payload);
 }
 
 /** *************************************************************
@@ -75,6 +84,38 @@ void ManualmaticMessenger::jogAxisStop(uint8_t axis ) {
 
 
 
+/**
+ * Jog two axes continuously in one command so the host can
+ * start (and stop) them together
+ */
+void ManualmaticMessenger::jogVector(uint8_t axis1, uint8_t axis2, float velocity1, float velocity2 ) {
+    char cmd[3];
+    cmd[0] = CMD_JOG_VECTOR;
+    cmd[1] = axis1+'0'; //Shift +48 for char of axis number
+    char payload[24];
+    char v[10];
+    payload[0] = axis2+'0';
+    payload[1] = ',';
+    payload[2] = '\0';
+    dtostrf(velocity1, 1, 1, v);
+    strcat(payload, v);
+    strcat(payload, ",");
+    dtostrf(velocity2, 1, 1, v);
+    strcat(payload, v);
+    serialMessage.send(cmd, payload);
+}
+
+/**
+ * The MPG has stopped turning - the host will stop the jog
+ * if the axis is still well short of the jogged distance
+ */
+void ManualmaticMessenger::sendJogIdle(uint8_t axis ) {
+    char cmd[3];
+    cmd[0] = CMD_JOG_IDLE;
+    cmd[1] = axis+'0'; //Shift +48 for char of axis number
+    serialMessage.send(cmd);
+}
+
 /**
  * Toggle between Tortoise and Rabbit jog speeds
  * 
@@ -88,6 +129,9 @@ void ManualmaticMessenger::toggleJogRange() {
  * Reset both Tortoise and Rabbit jog velocity to their defaults
  */
 void ManualmaticMessenger::resetJogVelocity() {
+  //The defaults replace anything not yet confirmed
+  state.pendingJogVelocity[JOG_RANGE_LOW].pending = false;
+  state.pendingJogVelocity[JOG_RANGE_HIGH].pending = false;
   state.jogVelocity[JOG_RANGE_LOW] = config.defaultJogVelocity[JOG_RANGE_LOW];  
   state.jogVelocity[JOG_RANGE_HIGH] = config.defaultJogVelocity[JOG_RANGE_HIGH];  
   serialMessage.send(CMD_JOG_VELOCITY, state.jogVelocity[state.jogVelocityRange]);
@@ -95,11 +139,13 @@ void ManualmaticMessenger::resetJogVelocity() {
 
 /**
  * Increment the jogVelocity and send to serial
- * Serial will return the set velocity which will update the display
+ * It is displayed straight away, serial will return the set velocity
+ * to confirm it
  */
 void ManualmaticMessenger::incrementJogVelocity(int16_t incr) {
     float velocity = state.jogVelocity[state.jogVelocityRange] + (incr * (config.jogVelocityIncrement[state.jogVelocityRange]));    
     velocity = max(min(velocity, config.maxJogVelocity), config.minJogVelocity);
+    state.setPendingValue(state.pendingJogVelocity[state.jogVelocityRange], state.jogVelocity[state.jogVelocityRange], velocity);
     serialMessage.send(CMD_JOG_VELOCITY, velocity);
 }
 
@@ -145,6 +191,7 @@ void ManualmaticMessenger::startSpindle() {
  * Send the spindle override
  */
 void ManualmaticMessenger::sendSpindleOverride(float pct /*=1*/) {
+  state.setPendingValue(state.pendingSpindleOverride, state.spindleOverride, pct);
   serialMessage.send(CMD_SPINDLE_OVERRIDE, pct, 3);
 }
 
@@ -156,15 +203,17 @@ void ManualmaticMessenger::incrementSpindleOverride(int16_t incr) {
    if ( state.spindleDirection != 0 ) {
     rate = min(rate, config.max_spindle_speed/abs(state.spindleSpeed));
   }
-  serialMessage.send(CMD_SPINDLE_OVERRIDE, rate, 3);
+  sendSpindleOverride(rate);
 }
 
 void ManualmaticMessenger::sendFeedrate(float pct /*=1*/) {
+  state.setPendingValue(state.pendingFeedrate, state.feedrate, pct);
   serialMessage.send(CMD_FEED_OVERRIDE, pct, 3);  
 }
 
 
 void ManualmaticMessenger::sendRapidrate(float pct /*=1*/) {
+  state.setPendingValue(state.pendingRapidrate, state.rapidrate, pct);
   serialMessage.send(CMD_RAPID_OVERRIDE, pct, 3);  
 }
 
@@ -175,7 +224,7 @@ void ManualmaticMessenger::incrementFeedrate(int16_t incr) {
   float rate = state.feedrate + (state.feedrate * (incr*0.01));
   //@TODO Check this
   rate = max(min(rate, config.max_feed_override), 0.01);
-  serialMessage.send(CMD_FEED_OVERRIDE, rate, 3);
+  sendFeedrate(rate);
 }
 
 /**
@@ -185,7 +234,7 @@ void ManualmaticMessenger::incrementRapidrate(int16_t incr) {
     //@TODO Check this
     float rate = state.rapidrate + (state.rapidrate * (incr*0.01));
     rate = max(min(rate, config.max_rapid_override), 0.01);
-    serialMessage.send(CMD_RAPID_OVERRIDE, rate, 3);
+    sendRapidrate(rate);
 }
 
 void ManualmaticMessenger::sendTaskMode(uint8_t mode) {
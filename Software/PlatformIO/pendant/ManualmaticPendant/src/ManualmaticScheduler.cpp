@@ -0,0 +1,71 @@
+#include "ManualmaticScheduler.h"
+
+bool ManualmaticScheduler::addTask(const char* name, uint32_t periodUs, uint8_t priority, std::function<void()> f) {
+  if ( numTasks >= MAX_TASKS ) {
+    return false;
+  }
+  //Keep the tasks sorted by priority
+  uint8_t i = numTasks;
+  while ( i > 0 && tasks[i-1].priority > priority ) {
+    tasks[i] = tasks[i-1];
+    i--;
+  }
+  tasks[i] = SchedulerTask_s();
+  tasks[i].name = name;
+  tasks[i].periodUs = periodUs;
+  tasks[i].priority = priority;
+  tasks[i].f = f;
+  tasks[i].lastRunUs = micros();
+  numTasks++;
+  return true;
+}
+
+void ManualmaticScheduler::tick() {
+  uint32_t startUs = micros();
+  bool periodicRun = false;
+  for ( uint8_t i=0; i<numTasks; i++ ) {
+    SchedulerTask_s& t = tasks[i];
+    uint32_t nowUs = micros();
+    if ( t.periodUs == 0 ) {
+      run(t, nowUs);
+    } else if ( nowUs - t.lastRunUs >= t.periodUs ) {
+      if ( periodicRun && nowUs - startUs >= budgetUs ) {
+        continue; //Next tick
+      }
+      uint32_t lateness = (nowUs - t.lastRunUs) - t.periodUs;
+      t.maxLatenessUs = max(t.maxLatenessUs, lateness);
+      if ( lateness >= t.periodUs ) {
+        t.missed++;
+      }
+      run(t, nowUs);
+      periodicRun = true;
+    }
+  }
+}
+
+void ManualmaticScheduler::run(SchedulerTask_s& t, uint32_t nowUs) {
+  t.lastRunUs = nowUs;
+  t.f();
+  t.maxRunUs = max(t.maxRunUs, micros() - nowUs);
+}
+
+void ManualmaticScheduler::takeStats(SchedulerStats_s& stats) {
+  stats = SchedulerStats_s();
+  stats.latestTask = "";
+  stats.longestTask = "";
+  for ( uint8_t i=0; i<numTasks; i++ ) {
+    SchedulerTask_s& t = tasks[i];
+    if ( t.maxLatenessUs > stats.maxLatenessUs ) {
+      stats.latestTask = t.name;
+      stats.maxLatenessUs = t.maxLatenessUs;
+    }
+    if ( t.maxRunUs > stats.maxRunUs ) {
+      stats.longestTask = t.name;
+      stats.maxRunUs = t.maxRunUs;
+    }
+    stats.missed += t.missed;
+    t.maxLatenessUs = 0;
+    t.maxRunUs = 0;
+    t.missed = 0;
+  }
+}
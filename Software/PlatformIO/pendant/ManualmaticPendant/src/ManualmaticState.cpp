@@ -2,7 +2,9 @@
 #include "ManualmaticState.h"
 
 
-ManualmaticState::ManualmaticState(ManualmaticConfig& config) :config(config) { }
+ManualmaticState::ManualmaticState(ManualmaticConfig& config) :config(config) { 
+  resetRtt();
+}
 
 
 /**
@@ -10,10 +12,11 @@ ManualmaticState::ManualmaticState(ManualmaticConfig& config) :config(config) {
  */
 void ManualmaticState::update(char cmd[2], char payload[30]) {
 //    if ( serialMessage.available(cmd, payload) ) {  
+    lastFrameReceived = now;
     switch ( cmd[0] ) {
       case CMD_ABSOLUTE_POS:
         if ( strchr("012345678", cmd[1]) != NULL ) {
-          axisAbsPos[((int)cmd[1])-48] = atof(payload); //There's probably a better way than -48...   
+          setAxisAbsPos(((int)cmd[1])-48, atof(payload)); //There's probably a better way than -48...   
         }
         break;
       case CMD_CURRENT_VEL:
@@ -28,7 +31,7 @@ void ManualmaticState::update(char cmd[2], char payload[30]) {
         spindleRpm = atof(payload);
         break;
       case CMD_SPINDLE_OVERRIDE:
-        spindleOverride = atof(payload);
+        onHostValue(pendingSpindleOverride, spindleOverride, atof(payload));
         break;
       case CMD_SPINDLE_DIRECTION:
         spindleDirection = atoi(payload);
@@ -37,16 +40,16 @@ void ManualmaticState::update(char cmd[2], char payload[30]) {
   //      feedSpeed = atof(payload);
   //      break;
       case CMD_FEED_OVERRIDE:
-        feedrate = atof(payload);
+        onHostValue(pendingFeedrate, feedrate, atof(payload));
         break;
       case CMD_SPINDLE_SPEED: // @TODO not used?
         spindleSpeed = atof(payload);
         break;
       case CMD_RAPID_OVERRIDE:
-        rapidrate = atof(payload);
+        onHostValue(pendingRapidrate, rapidrate, atof(payload));
         break;
       case CMD_JOG_VELOCITY:
-          jogVelocity[jogVelocityRange] = atof(payload);
+          onHostValue(pendingJogVelocity[jogVelocityRange], jogVelocity[jogVelocityRange], atof(payload));
         break;
       case CMD_TASK_MODE:
         setTaskMode( static_cast<Task_mode_e>(cmd[1]-'0'));
@@ -109,10 +112,18 @@ void ManualmaticState::update(char cmd[2], char payload[30]) {
         mist = static_cast<Mist_e>(cmd[1]-'0');
         break;
       case CMD_HEARTBEAT:
-        lastHeartbeatReceived = now;
-        if ( iniState == INI_STATE_DISCONNECTED ) {
+        //Only the host's bare kickstart connects, not a late echo
+        if ( iniState == INI_STATE_DISCONNECTED && payload[0] == '\0' ) {
           onConnected();
         }
+        onHeartbeat(payload);
+        break;
+      case CMD_JOB_RESULT:
+        if ( cmd[1] == JOB_REJECTED ) {
+          setErrorMessage(ERRMSG_REJECTED);
+        } else if ( cmd[1] == JOB_TIMED_OUT ) {
+          setErrorMessage(ERRMSG_TIMED_OUT);
+        }
         break;
     }
   }
@@ -232,6 +243,40 @@ void ManualmaticState::incrementJogIncrement(int16_t incr) {
   currentJogIncrement = min(max(0, currentJogIncrement+incr),3);
 }
 
+void ManualmaticState::setAxisAbsPos(uint8_t axis, float pos) {
+  uint32_t t = micros();
+  uint32_t dt = t - axisAbsPosMicros[axis];
+  if ( axisAbsPosMicros[axis] != 0 && dt > 0 && dt < (config.predictiveDroMaxMs * 1000UL) ) {
+    float v = (pos - axisAbsPos[axis]) * 1000000.0 / dt;
+    //Average with the previous estimate unless we've changed direction
+    axisVelocity[axis] = ( (v > 0) == (axisVelocity[axis] > 0) ) ? (axisVelocity[axis] + v) / 2 : v;
+    axisAbsPosIntervalMicros[axis] = dt;
+  } else {
+    //First sample or we've been stationary
+    axisVelocity[axis] = 0;
+  }
+  axisAbsPos[axis] = pos;
+  axisAbsPosMicros[axis] = t;
+}
+
+float ManualmaticState::predictedAbsPos(uint8_t axis) {
+  if ( !config.predictiveDro || current_vel == 0 || axisVelocity[axis] == 0 ) {
+    return axisAbsPos[axis];
+  }
+  uint32_t elapsed = micros() - axisAbsPosMicros[axis];
+  if ( elapsed > config.predictiveDroMaxMs * 1000UL ) {
+    return axisAbsPos[axis];
+  }
+  //Other axes may still be moving, but this one has missed an update
+  if ( elapsed > max(2 * axisAbsPosIntervalMicros[axis], axisStoppedMinMs * 1000UL) ) {
+    axisVelocity[axis] = 0;
+    return axisAbsPos[axis];
+  }
+  //No single axis can be moving faster than the machine
+  float v = constrain(axisVelocity[axis], -abs(current_vel), abs(current_vel));
+  return axisAbsPos[axis] + (v * elapsed / 1000000.0);
+}
+
 /**
  * @brief Set the commanded spindle speed
  * 
@@ -323,6 +368,9 @@ void ManualmaticState::setIniValue(char cmd1, char* payload) {
     case INI_NO_FORCE_HOMING:
       config.noForceHoming = (atoi(payload) == 1);
       break;
+    case INI_TRACE_LATENCY:
+      config.traceLatency = (atoi(payload) == 1);
+      break;
     case INI_COMPLETE:
       iniState = INI_STATE_RECEIVED;
       break;
@@ -350,13 +398,84 @@ bool ManualmaticState::isReady(bool setMessage /*= true*/)  {
   return true;
 }
 
+void ManualmaticState::onHeartbeat(char* payload) {
+  char* p = payload;
+  uint16_t seq = strtoul(p, &p, 10);
+  if ( *p++ != ':' ) {
+    return;
+  }
+  uint32_t sent = strtoul(p, &p, 10);
+  if ( *p != ':' ) {
+    return;
+  }
+  //Only the echo of the last heartbeat sent - a late one would inflate the rtt
+  if ( seq != heartbeatSeq || sent != heartbeatSentMicros ) {
+    return;
+  }
+  uint32_t rtt = micros() - sent;
+  lastRttUs = rtt;
+  if ( heartbeatRttUs == 0 ) {
+    heartbeatRttUs = rtt;
+  } else {
+    heartbeatRttUs += ((int32_t)(rtt - heartbeatRttUs)) / 8;
+  }
+}
+
+void ManualmaticState::setPendingValue(PendingValue_s& p, float& value, float newValue) {
+  if ( !p.pending ) {
+    p.hostValue = value;
+    p.pending = true;
+  }
+  p.changedMs = now;
+  value = newValue;
+}
+
+void ManualmaticState::onHostValue(PendingValue_s& p, float& value, float hostValue) {
+  p.hostValue = hostValue;
+  if ( p.pending && fabs(hostValue - value) > pendingValueTolerance ) {
+    return; //The host hasn't caught up yet
+  }
+  p.pending = false;
+  value = hostValue;
+}
+
+void ManualmaticState::checkPendingValues() {
+  uint32_t timeoutMs = max(3 * heartbeatRttUs / 1000, (uint32_t)config.pendingValueMinMs);
+  expirePendingValue(pendingFeedrate, feedrate, timeoutMs);
+  expirePendingValue(pendingRapidrate, rapidrate, timeoutMs);
+  expirePendingValue(pendingSpindleOverride, spindleOverride, timeoutMs);
+  expirePendingValue(pendingJogVelocity[JOG_RANGE_LOW], jogVelocity[JOG_RANGE_LOW], timeoutMs);
+  expirePendingValue(pendingJogVelocity[JOG_RANGE_HIGH], jogVelocity[JOG_RANGE_HIGH], timeoutMs);
+}
+
+void ManualmaticState::expirePendingValue(PendingValue_s& p, float& value, uint32_t timeoutMs) {
+  if ( p.pending && now - p.changedMs > timeoutMs ) {
+    p.pending = false;
+    value = p.hostValue;
+  }
+}
+
+void ManualmaticState::clearPendingValues() {
+  pendingFeedrate.pending = false;
+  pendingRapidrate.pending = false;
+  pendingSpindleOverride.pending = false;
+  pendingJogVelocity[JOG_RANGE_LOW].pending = false;
+  pendingJogVelocity[JOG_RANGE_HIGH].pending = false;
+}
+
+void ManualmaticState::resetRtt() {
+  heartbeatRttUs = 0;
+  lastRttUs = 0;
+}
+
 void ManualmaticState::onConnected() {
   iniState = INI_STATE_CONNECTED;
+  lastFrameReceived = now;
 }
 
 void ManualmaticState::onDisconnected() {
   iniState = INI_STATE_DISCONNECTED;
-  lastHeartbeatReceived = 0;
-  lastHeartbeatSent = 0;
+  resetRtt();
+  clearPendingValues();
   setScreen(SCREEN_SPLASH);
 }
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "ManualmaticTelemetry.h"
+
+ManualmaticTelemetry::ManualmaticTelemetry(ManualmaticMessage& message, ManualmaticConfig& config, ManualmaticState& state, ManualmaticScheduler& scheduler)
+  : message(message), config(config), state(state), scheduler(scheduler) {
+  reset();
+}
+
+void ManualmaticTelemetry::begin() {
+  //Already running on Teensy 4 but make sure
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+  lastCycles = ARM_DWT_CYCCNT;
+}
+
+void ManualmaticTelemetry::onLoop() {
+  uint32_t cycles = ARM_DWT_CYCCNT;
+  uint32_t us = (cycles - lastCycles) / (F_CPU_ACTUAL / 1000000);
+  lastCycles = cycles;
+  uint8_t bucket = 0;
+  while ( bucket < HISTOGRAM_BUCKETS - 1 && (us >> (bucket + 1)) != 0 ) {
+    bucket++;
+  }
+  histogram[bucket]++;
+  loops++;
+  totalUs += us;
+  maxUs = max(maxUs, us);
+  //A whole frame is at least STX + cmd + ETX
+  if ( message.rxBacklog() > 3 ) {
+    rxBacklogLoops++;
+  }
+}
+
+void ManualmaticTelemetry::onDisplayDraw(uint32_t us) {
+  if ( us > config.displayOverrunUs ) {
+    displayOverruns++;
+  }
+}
+
+uint32_t ManualmaticTelemetry::percentileUs(float pct) {
+  uint32_t target = (uint32_t)(loops * pct);
+  uint32_t count = 0;
+  for ( uint8_t b=0; b<HISTOGRAM_BUCKETS; b++ ) {
+    if ( count + histogram[b] >= target && histogram[b] > 0 ) {
+      //Bucket b spans 2^b to 2^(b+1)-1 (bucket 0 also holds 0)
+      uint32_t low = b == 0 ? 0 : (1UL << b);
+      uint32_t span = (2UL << b) - 1 - low;
+      uint32_t us = low + (uint32_t)((uint64_t)span * (target - count) / histogram[b]);
+      return min(us, maxUs);
+    }
+    count += histogram[b];
+  }
+  return maxUs;
+}
+
+void ManualmaticTelemetry::report() {
+  SchedulerStats_s stats;
+  scheduler.takeStats(stats);
+  if ( state.iniState == INI_STATE_SENT && loops > 0 ) {
+    char cmd[3];
+    char task[32];
+    cmd[0] = CMD_TELEMETRY;
+    cmd[1] = TELEMETRY_LOOPS;
+    message.send(cmd, loops);
+    cmd[1] = TELEMETRY_MAX;
+    message.send(cmd, maxUs);
+    cmd[1] = TELEMETRY_P99;
+    message.send(cmd, percentileUs(0.99));
+    cmd[1] = TELEMETRY_AVG;
+    message.send(cmd, (uint32_t)(totalUs / loops));
+    cmd[1] = TELEMETRY_DISPLAY_OVERRUNS;
+    message.send(cmd, displayOverruns);
+    cmd[1] = TELEMETRY_RX_BACKLOG;
+    message.send(cmd, rxBacklogLoops);
+    cmd[1] = TELEMETRY_TASK_LATE;
+    snprintf(task, sizeof(task), "%s:%lu", stats.latestTask, (unsigned long)stats.maxLatenessUs);
+    message.send(cmd, task);
+    cmd[1] = TELEMETRY_TASK_RUN;
+    snprintf(task, sizeof(task), "%s:%lu", stats.longestTask, (unsigned long)stats.maxRunUs);
+    message.send(cmd, task);
+    cmd[1] = TELEMETRY_TASK_MISSED;
+    message.send(cmd, stats.missed);
+    cmd[1] = TELEMETRY_COMPLETE;
+    message.send(cmd);
+  }
+  reset();
+}
+
+void ManualmaticTelemetry::reset() {
+  memset(histogram, 0, sizeof(histogram));
+  loops = 0;
+  maxUs = 0;
+  totalUs = 0;
+  displayOverruns = 0;
+  rxBacklogLoops = 0;
+}
@@ -0,0 +1,93 @@
+#!/usr/bin/python3
+##
+#
+# Check that a jog stop always wins over jogs the rate limit is still
+# holding back: once an axis has been stopped (or the machine aborted,
+# estopped or switched mode) nothing waiting may start it again.
+#
+# Uses the linuxcnc_mock, so no LinuxCNC or pendant is needed.
+# From a command prompt in this directory:
+#
+# $ ./jog_stop_test.py
+#
+# GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+#
+# Copyright (c) 2022 Philip Fletcher <philip.fletcher@stutchbury.com>
+#
+##
+
+import sys
+import time
+import queue
+
+sys.argv = sys.argv[:1] + ['mock.ini']
+sys.path.append('../linuxcnc/python-component/')
+
+from Manualmatic import Manualmatic, SerialInterface
+from linuxcnc_mock import linuxcnc_mock, hal
+
+
+def newManualmatic():
+  h = hal()
+  m = Manualmatic(linuxcnc_mock(h), h, {}, SerialInterface())
+  m.ls.axis_mask = 7
+  m.ls.motion_mode = m.linuxcnc.TRAJ_MODE_TELEOP
+  m.writeToSerial = lambda cmd, payload="": True
+  return m
+
+# Everything the command thread would run, in order
+def drain(m):
+  queued = []
+  while True:
+    try:
+      queued.append(m.commands.get_nowait())
+    except queue.Empty:
+      return queued
+
+# Use up the burst so the next jog is held back by the rate limit
+def exhaustBurst(m):
+  m.mailbox.tokens = 0
+  m.mailbox.refilled = time.monotonic()
+
+# The jogs the command thread would still start, with their payloads
+def jogsLeft(m):
+  m.mailbox.tokens = m.mailbox.burst
+  m.mailbox.admitDeferred()
+  left = []
+  for handler, args in drain(m):
+    if ( handler == m.executeLatest ):
+      entry = m.mailbox.take(args[0])
+      if ( entry is not None and m.isWaitingJog(entry[0], entry[1]) ):
+        left.append(entry[:2])
+  return left
+
+
+def check(name, waiting, then):
+  m = newManualmatic()
+  exhaustBurst(m)
+  for cmd, payload in waiting:
+    m.processCmd(cmd, payload)
+  assert m.mailbox.deferred, name + ": nothing was held back"
+  m.processCmd(*then)
+  left = jogsLeft(m)
+  assert not left, name + ": would still jog " + repr(left)
+  print("ok", name)
+
+
+if __name__ == '__main__':
+  check("n after deferred V", [('V0', '1,10,10')], ('n1', ''))
+  check("N stop after deferred V", [('V0', '1,10,10')], ('N0', '0'))
+  check("V stop after deferred N", [('N1', '10')], ('V0', '1,0,0'))
+  check("V stop after deferred J", [('J0', '0.1')], ('V0', '1,0,0'))
+  check("mode change after deferred J", [('J0', '0.1')], ('M1', ''))
+  check("abort after deferred N", [('N0', '10')], ('!', ''))
+  check("estop after deferred V", [('V0', '1,10,10')], ('E1', ''))
+  # A waiting stop for one axis survives a stop for another
+  m = newManualmatic()
+  exhaustBurst(m)
+  m.processCmd('V0', '1,10,10')
+  m.processCmd('V0', '1,0,0')
+  m.processCmd('n1', '')
+  queued = [args[0] for handler, args in drain(m)]
+  assert 'V0' in queued and m.mailbox.take('V0')[1] == '1,0,0', "V0 stop was lost"
+  print("ok waiting stop kept")
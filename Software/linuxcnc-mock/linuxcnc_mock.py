@@ -20,6 +20,7 @@ class command_mock():
     self.ls = ls
 
   ls = None
+  serial = 0 # Every command completes straight away, see echo_serial_number
 
 
   
@@ -62,7 +63,7 @@ class command_mock():
     self.ls.task_mode = m
   # ##########################
   def teleop_enable(self, en):
-    None
+    self.ls.motion_mode = self.ls.TRAJ_MODE_TELEOP if en else self.ls.TRAJ_MODE_FREE
 
   # ##########################
   def wait_complete(self):
@@ -78,8 +79,9 @@ class command_mock():
     self.ls.spindle[0]["override"] = incr
 
   # ##########################
-  def jog(self, JOG_INCREMENT, jjogmode, axis, vel, distance):
-    self.ls.actual_position[axis] += distance
+  def jog(self, jogmode, jjogmode, axis, vel=0, distance=0):
+    if ( jogmode == self.ls.JOG_INCREMENT ):
+      self.ls.actual_position[axis] += distance
 
   # ##########################
   def set_feed_override(self, b):
@@ -156,9 +158,12 @@ class linuxcnc_mock():
 
   INTERP_IDLE=1 
 
+  TRAJ_MODE_FREE=1
   TRAJ_MODE_TELEOP=3
 
+  JOG_STOP=0
   JOG_INCREMENT=1
+  JOG_CONTINUOUS=2
 
   SPINDLE_OFF=0
   SPINDLE_FORWARD=1
@@ -226,6 +231,7 @@ class linuxcnc_mock():
   task_paused = None
   file = "test.file"
   state = RCS_DONE
+  echo_serial_number = 0
   program_state = None
 
 
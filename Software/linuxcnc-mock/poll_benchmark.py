@@ -0,0 +1,187 @@
+#!/usr/bin/python3
+##
+#
+# Compare the cost of one poll() cycle's change detection: the original
+# per value getters (a lambda, compare and format for every value)
+# against the MachineState snapshot now used by Manualmatic. Also 
+# shows the frames saved by rounding positions to the pendant's 
+# display precision ([MANUALMATIC] DRO_PRECISION).
+#
+# Uses the linuxcnc_mock stat object, so no LinuxCNC is needed.
+# From a command prompt in this directory:
+#
+# $ ./poll_benchmark.py [cycles]
+#
+# GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+#
+# Copyright (c) 2022 Philip Fletcher <philip.fletcher@stutchbury.com>
+#
+##
+
+import sys
+import time
+import random
+
+sys.path.append('../linuxcnc/python-component/')
+
+from Manualmatic import Commands, MachineState, MachineStateValue, MachineStateCommand, MachineStateArray, fmtround5
+from linuxcnc_mock import linuxcnc_mock, hal
+
+
+# #########################################################
+# The previous implementation, one object and getter per value
+class OldStateValue:
+  def __init__(self, cmd, getter, formatter=format):
+    self.cmd = cmd
+    self.getter = getter
+    self.formatter = formatter
+    self.last_value = None
+    self.dirty = True
+  def update(self, owner):
+    current_value = self.getter()
+    if current_value != self.last_value:
+      self.last_value = current_value
+      self.dirty = True
+    if self.dirty:
+      if self.send(owner):
+        self.dirty = False
+  def send(self, owner):
+    return owner.writeToSerial(self.cmd, self.formatter(self.last_value))
+
+class OldStateCommand(OldStateValue):
+  def send(self, owner):
+    return owner.writeToSerial(self.cmd + self.formatter(self.last_value))
+
+def oldStateValueForIndex(cmd, getter, formatter, index):
+  return OldStateValue(cmd + str(index), lambda: getter(index), formatter)
+
+class OldStateArray:
+  def __init__(self, cmd, indexes, getter, formatter=format):
+    self.values = [ oldStateValueForIndex(cmd, getter, formatter, index) for index in indexes ]
+  def update(self, owner):
+    for i in self.values:
+      i.update(owner)
+
+class OldState:
+  def __init__(self, ls, axes, is_homed):
+    self.values = [
+      OldStateCommand(Commands.CMD_G5X_INDEX, lambda: ls.g5x_index),
+      OldStateArray(Commands.CMD_G5X_OFFSET, axes, lambda i: ls.g5x_offset[i], formatter=fmtround5),
+      OldStateArray(Commands.CMD_G92_OFFSET, axes, lambda i: ls.g92_offset[i], formatter=fmtround5),
+      OldStateArray(Commands.CMD_TOOL_OFFSET, axes, lambda i: ls.tool_offset[i], formatter=fmtround5),
+      OldStateArray(Commands.CMD_ABSOLUTE_POS, axes, lambda i: ls.actual_position[i], formatter=fmtround5),
+      OldStateArray(Commands.CMD_DTG, axes, lambda i: ls.dtg[i], formatter=fmtround5),
+      OldStateValue(Commands.CMD_SPINDLE_OVERRIDE, lambda: ls.spindle[0]["override"]),
+      OldStateValue(Commands.CMD_SPINDLE_DIRECTION, lambda: ls.spindle[0]["direction"]),
+      OldStateValue(Commands.CMD_FEED_OVERRIDE, lambda: ls.feedrate),
+      OldStateValue(Commands.CMD_RAPID_OVERRIDE, lambda: ls.rapidrate),
+      OldStateCommand(Commands.CMD_TASK_MODE, lambda: ls.task_mode),
+      OldStateArray(Commands.CMD_HOMED, axes, lambda i: ls.homed[i]),
+      OldStateCommand(Commands.CMD_ALL_HOMED, lambda: 1 if is_homed() else 0),
+      OldStateValue(Commands.CMD_INTERP_STATE, lambda: ls.interp_state),
+      OldStateValue(Commands.CMD_CURRENT_VEL, lambda: ls.current_vel),
+      OldStateCommand(Commands.CMD_MOTION_TYPE, lambda: ls.motion_type),
+      OldStateCommand(Commands.CMD_FLOOD, lambda: ls.flood),
+      OldStateCommand(Commands.CMD_MIST, lambda: ls.mist),
+    ]
+  def update(self, owner):
+    for value in self.values:
+      value.update(owner)
+
+
+# The same channels as Manualmatic.resetState()
+def newState(ls, axes, is_homed, quantum=None, deadband=0, vel_quantum=None):
+  return MachineState([
+    MachineStateCommand(Commands.CMD_G5X_INDEX, 'g5x_index'),
+    MachineStateArray(Commands.CMD_G5X_OFFSET, axes, 'g5x_offset', formatter=fmtround5),
+    MachineStateArray(Commands.CMD_G92_OFFSET, axes, 'g92_offset', formatter=fmtround5),
+    MachineStateArray(Commands.CMD_TOOL_OFFSET, axes, 'tool_offset', formatter=fmtround5),
+    MachineStateArray(Commands.CMD_ABSOLUTE_POS, axes, 'actual_position', formatter=fmtround5, 
+      quantum=quantum, deadband=deadband),
+    MachineStateArray(Commands.CMD_DTG, axes, 'dtg', formatter=fmtround5, quantum=quantum, deadband=deadband),
+    MachineStateValue(Commands.CMD_SPINDLE_OVERRIDE, lambda: ls.spindle[0]["override"]),
+    MachineStateValue(Commands.CMD_SPINDLE_DIRECTION, lambda: ls.spindle[0]["direction"]),
+    MachineStateValue(Commands.CMD_FEED_OVERRIDE, 'feedrate'),
+    MachineStateValue(Commands.CMD_RAPID_OVERRIDE, 'rapidrate'),
+    MachineStateCommand(Commands.CMD_TASK_MODE, 'task_mode'),
+    MachineStateArray(Commands.CMD_HOMED, axes, 'homed'),
+    MachineStateCommand(Commands.CMD_ALL_HOMED, lambda: 1 if is_homed() else 0),
+    MachineStateValue(Commands.CMD_INTERP_STATE, 'interp_state'),
+    MachineStateValue(Commands.CMD_CURRENT_VEL, 'current_vel', quantum=vel_quantum),
+    MachineStateCommand(Commands.CMD_MOTION_TYPE, 'motion_type'),
+    MachineStateCommand(Commands.CMD_FLOOD, 'flood'),
+    MachineStateCommand(Commands.CMD_MIST, 'mist'),
+  ])
+
+# With the Manualmatic defaults, 3 decimal places
+def quantizedState(ls, axes, is_homed):
+  return newState(ls, axes, is_homed, quantum=0.001, deadband=0.00075, vel_quantum=1/60)
+
+
+# #########################################################
+class CountingOwner:
+  def __init__(self, ls):
+    self.ls = ls # MachineState reads its owner's stat
+    self.frames = []
+  def writeToSerial(self, cmd, payload=""):
+    self.frames.append(cmd + payload)
+    return True
+  def writeUpdateToSerial(self, key, cmd, payload=""):
+    return self.writeToSerial(cmd, payload)
+  def onWritten(self, callback):
+    callback(True)
+
+
+# Nothing changes, three axes are stopped under servo control (a few 
+# tenths of a micron of jitter) or moving (positions, DTG and velocity)
+def idle(ls, cycle):
+  pass
+
+noise = random.Random(1)
+def jitter(ls, cycle):
+  if cycle == 0:
+    noise.seed(1) # The same noise for every run
+  for i in range(3):
+    ls.actual_position[i] = 10.0045 * (i + 1) + noise.uniform(-0.0002, 0.0002)
+
+def moving(ls, cycle):
+  for i in range(3):
+    ls.actual_position[i] = cycle * 0.0013 * (i + 1)
+    ls.dtg[i] = 100 - ls.actual_position[i]
+  ls.current_vel = 10 + (cycle % 7) * 0.1
+
+
+def run(make_state, scenario, cycles):
+  ls = linuxcnc_mock(hal())
+  # The mock's lists are class attributes, start each run afresh
+  ls.actual_position = [0.0] * 9
+  ls.dtg = [0.0] * 9
+  ls.spindle = [{'override': 1.0, 'direction': 0}]
+  axes = [0, 1, 2, 3]
+  is_homed = lambda: ls.homed.count(1) == ls.joints
+  state = make_state(ls, axes, is_homed)
+  owner = CountingOwner(ls)
+  state.update(owner) # Everything is sent the first time
+  owner.frames = []
+  start = time.perf_counter()
+  for cycle in range(cycles):
+    scenario(ls, cycle)
+    state.update(owner)
+  elapsed = time.perf_counter() - start
+  return elapsed, owner.frames
+
+
+if __name__ == '__main__':
+  cycles = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+  print("{} cycles, 4 axes".format(cycles))
+  for scenario in (idle, jitter, moving):
+    results = []
+    for name, make_state in (('old', OldState), ('snapshot', newState), ('quantized', quantizedState)):
+      elapsed, frames = min((run(make_state, scenario, cycles) for i in range(3)), key=lambda r: r[0])
+      results.append((name, elapsed, frames))
+    assert sorted(results[0][2]) == sorted(results[1][2]), "different frames sent"
+    print("{:>7}:".format(scenario.__name__),
+      "  ".join("{} {:.2f}us/cycle".format(name, elapsed * 1000000 / cycles) for name, elapsed, f in results),
+      "  x{:.1f}".format(results[0][1] / results[1][1]))
+    print("{:>7}  frames/cycle:".format(''),
+      "  ".join("{} {:.2f}".format(name, len(frames) / cycles) for name, e, frames in results[1:]))
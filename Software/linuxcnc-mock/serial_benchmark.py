@@ -0,0 +1,165 @@
+#!/usr/bin/python3
+##
+#
+# Compare the cost of framing serial input from the pendant: the
+# original character at a time state machine against the bulk
+# bytes.find() reader now in SerialInterface.
+#
+# No pendant or LinuxCNC is needed, the input is replayed from memory
+# in USB sized reads. From a command prompt in this directory:
+#
+# $ ./serial_benchmark.py [frames]
+#
+# GPLv2 Licence https://www.gnu.org/licenses/old-licenses/gpl-2.0.txt
+#
+# Copyright (c) 2022 Philip Fletcher <philip.fletcher@stutchbury.com>
+#
+##
+
+import sys
+import time
+import random
+
+sys.path.append('../linuxcnc/python-component/')
+
+from Manualmatic import SerialInterface
+
+
+# #########################################################
+# Replays a byte string as if it were arriving on the port,
+# chunk_size bytes per select()
+class ReplayConnection:
+  def __init__(self, data, chunk_size):
+    self.data = data
+    self.pos = 0
+    self.chunk_size = chunk_size
+  @property
+  def in_waiting(self):
+    return min(self.chunk_size, len(self.data) - self.pos)
+  def read(self, size=1):
+    chunk = self.data[self.pos:self.pos+size]
+    self.pos += len(chunk)
+    return chunk
+  def readable(self):
+    return self.pos < len(self.data)
+
+
+# #########################################################
+# Just counts what it is given
+class CountingOwner:
+  def __init__(self):
+    self.commands = []
+    self.errors = 0
+  def processCmd(self, cmd, payload):
+    self.commands.append((cmd, payload))
+  def serialError(self, error):
+    self.errors += 1
+  def onDisconnected(self):
+    pass
+
+
+# #########################################################
+# The previous reader: everything waiting is read but each byte is
+# then fed through processCharacter() one at a time
+class CharSerialInterface(SerialInterface):
+  RX_STATE_BEGIN=0
+  RX_STATE_COMMAND=1
+
+  def __init__(self):
+    super().__init__()
+    self.rx_state = self.RX_STATE_BEGIN
+    self.rx_state_count = 0
+    self.rx_buffer = None
+
+  def inputError(self, error):
+    self.owner.serialError(error)
+    self.rx_state = self.RX_STATE_BEGIN
+
+  def processCharacter(self, c):
+    if c == self.STX:
+      if self.rx_state != self.RX_STATE_BEGIN:
+        self.inputError("Possible truncated packet")
+      self.rx_state = self.RX_STATE_COMMAND
+      self.rx_state_count = 0
+      self.rx_buffer = bytearray(self.RX_MAX)
+    elif c == self.ETX:
+      if self.rx_state == self.RX_STATE_COMMAND:
+        if self.rx_state_count < 1:
+          self.inputError("Command too short")
+        else:
+          data = self.rx_buffer.decode('iso-8859-1')
+          self.rx_time = time.monotonic()
+          self.owner.processCmd(data[0:2], data[2:].strip('\00'))
+          self.rx_state = self.RX_STATE_BEGIN
+          return True
+      else:
+        self.inputError("Unexpected ETX")
+    elif self.rx_state == self.RX_STATE_COMMAND:
+      if self.rx_state_count >= self.RX_MAX:
+        self.inputError("Command too long")
+      else:
+        self.rx_buffer[self.rx_state_count] = ord(c)
+        self.rx_state_count += 1
+    elif self.rx_state == self.RX_STATE_BEGIN:
+      self.inputError("Unexpected input character:" + repr(c))
+    return False
+
+  def handleSerialInput(self):
+    handled = False
+    self.rx_pending += self.connection.read(max(1, self.connection.in_waiting))
+    if self.dispatchEstop():
+      handled = True
+    while self.rx_pending:
+      c = bytes(self.rx_pending[0:1])
+      del self.rx_pending[0]
+      if self.processCharacter(c):
+        handled = True
+    return handled
+
+
+# #########################################################
+# A busy few seconds: MPG and joystick jogs, overrides, heartbeats
+# and telemetry, some with latency traces
+def makeInput(frames):
+  rnd = random.Random(1)
+  samples = [
+    lambda: 'JX{:.3f}'.format(rnd.uniform(-5, 5)),
+    lambda: 'jY{:.1f}'.format(rnd.uniform(-3000, 3000)),
+    lambda: 'JZ{:.3f}~{:04X}{:08X}'.format(rnd.uniform(-1, 1), rnd.randrange(0x10000), rnd.randrange(0x100000000)),
+    lambda: 'f {:.2f}'.format(rnd.uniform(0, 1.5)),
+    lambda: 'H1{}:{}:{}'.format(rnd.randrange(1000), rnd.randrange(100000000), rnd.randrange(2000)),
+    lambda: 'tm{}'.format(rnd.randrange(2000)),
+  ]
+  data = bytearray()
+  for i in range(frames):
+    data += SerialInterface.STX + rnd.choice(samples)().encode() + SerialInterface.ETX
+  return bytes(data)
+
+
+def run(intf_class, data, chunk_size):
+  owner = CountingOwner()
+  intf = intf_class()
+  intf.setOwner(owner)
+  intf.connection = ReplayConnection(data, chunk_size)
+  start = time.perf_counter()
+  while intf.connection.readable():
+    intf.handleSerialInput()
+  elapsed = time.perf_counter() - start
+  return elapsed, owner
+
+
+if __name__ == '__main__':
+  frames = int(sys.argv[1]) if len(sys.argv) > 1 else 100000
+  data = makeInput(frames)
+  print("{} frames, {} bytes".format(frames, len(data)))
+  # 64 bytes is a full USB packet, 1 byte is a port read as soon as anything arrives
+  for chunk_size in (1, 16, 64, 4096):
+    results = []
+    for intf_class in (CharSerialInterface, SerialInterface):
+      elapsed, owner = min((run(intf_class, data, chunk_size) for i in range(3)), key=lambda r: r[0])
+      assert len(owner.commands) == frames and owner.errors == 0
+      results.append((intf_class.__name__, elapsed, owner.commands))
+    assert results[0][2] == results[1][2], "readers disagree"
+    print("read size {:>4}:".format(chunk_size),
+      "  ".join("{} {:.2f}us/frame".format(name, elapsed * 1000000 / frames) for name, elapsed, c in results),
+      "  x{:.1f}".format(results[0][1] / results[1][1]))
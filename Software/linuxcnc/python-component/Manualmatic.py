@@ -12,12 +12,17 @@
 
 import glob
 import os
+import queue
 import serial
 import sys
 import time
 import threading
 import re
+import selectors
 import subprocess
+from collections import deque
+from itertools import compress, count
+from operator import attrgetter, itemgetter, ne
 
 # https://www.linuxcnc.org/docs/html/gui/GStat.html
 #from hal_glib import GStat
@@ -57,6 +62,8 @@ class Commands:
   CMD_JOG_VELOCITY = 'j' #Jog Velocity IN/OUT (sorta)
   CMD_JOG_CONTINUOUS = 'N' #Jog continuous (nudge)
   CMD_JOG_STOP = 'n' #no Jog
+  CMD_JOG_IDLE = 'w' #MPG wheel has stopped
+  CMD_JOG_VECTOR = 'V' #Jog two axes together: cmd[1] axis1, payload "axis2,vel1,vel2"
   CMD_TASK_MODE = 'M' #mode IN/OUT
   CMD_TASK_STATE = 'E' #task_state (Estop and On/Off) IN/OUT
   CMD_INTERP_STATE = 'I' #interp_state
@@ -76,6 +83,8 @@ class Commands:
   CMD_PROGRAM_STATE = 'p' #OUT: Running, paused, stepping
   CMD_AUTO = 'a' #IN: RUN, PAUSE, RESUME, STEP progam
   CMD_HEARTBEAT = 'b' #Heartbeat
+  CMD_TELEMETRY = 'Y' #Pendant loop timing IN
+  CMD_JOB_RESULT = 'K' #OUT: cmd[1] is the result of a command that had to wait for LinuxCNC, payload is the command
 
   # Valid values for cmd[1] when cmd[0] is CMD_INI_VALUE
   INI_AXES = 'a' #Number of axes 
@@ -90,26 +99,334 @@ class Commands:
   INI_DEFAULT_LINEAR_VELOCITY = 'v'
   INI_MAX_LINEAR_VELOCITY = 'V'
   INI_NO_FORCE_HOMING = 'h'
+  INI_TRACE_LATENCY = 'L'
   INI_COMPLETE = '.'
 
+  # Valid values for cmd[1] when cmd[0] is CMD_TELEMETRY
+  TELEMETRY_LOOPS = 'n'
+  TELEMETRY_MAX = 'm' #us
+  TELEMETRY_P99 = 'p' #us
+  TELEMETRY_AVG = 'a' #us
+  TELEMETRY_DISPLAY_OVERRUNS = 'd'
+  TELEMETRY_RX_BACKLOG = 'q'
+  TELEMETRY_TASK_LATE = 'l' #name:us
+  TELEMETRY_TASK_RUN = 'r' #name:us
+  TELEMETRY_TASK_MISSED = 'x'
+  TELEMETRY_COMPLETE = '.'
+
+  # Valid values for cmd[1] when cmd[0] is CMD_JOB_RESULT
+  JOB_OK = '0'
+  JOB_REJECTED = '1'
+  JOB_TIMED_OUT = '2'
+
+  # Appended to the payload of traced frames: ~ id(4 hex) micros(8 hex)
+  TRACE_SEPARATOR = '~'
+
+# #########################################################
+# Heartbeat round trip time and the offset between the pendant's
+# micros() and the host's time.monotonic().
+# The pendant sends "seq:micros:rtt" where rtt is its measurement of
+# the previous exchange (0 if there isn't one). We echo back
+# "seq:micros:our micros" so it can do the same.
+# The offset is taken from the exchange with the shortest round trip
+# (least queuing) of the last SAMPLES, assuming the link is symmetric.
+class ClockSync:
+  SAMPLES = 8
+
+  def __init__(self):
+    self.reset()
+
+  def reset(self):
+    self.samples = deque(maxlen=self.SAMPLES) # (rtt, offset)
+    self.pending = None # (seq, arrival - pendant time) of the last heartbeat
+    self.last_us = None
+    self.last_unwrapped = 0
+    self.rtt = None # Smoothed, seconds
+    self.offset = None # Host time - pendant time, seconds
+
+  # #########################################################
+  # Pendant time in seconds. micros() wraps every 71 minutes so
+  # unwrap relative to the last heartbeat.
+  def pendantTime(self, us, update=False):
+    if self.last_us is None:
+      if not update:
+        return None
+      self.last_us = us
+      self.last_unwrapped = us
+    delta = ((us - self.last_us + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+    unwrapped = self.last_unwrapped + delta
+    if update:
+      self.last_us = us
+      self.last_unwrapped = unwrapped
+    return unwrapped / 1000000
+
+  # #########################################################
+  # Host time for a pendant micros(), or None if not yet known
+  def toHost(self, us):
+    if self.offset is None:
+      return None
+    return self.pendantTime(us) + self.offset
+
+  # #########################################################
+  # Returns the payload to echo back, or None if there isn't one
+  def onHeartbeat(self, payload, rx_time):
+    try:
+      seq, us, rtt = (int(v) for v in payload.split(':'))
+    except ValueError:
+      return None
+    forward = rx_time - self.pendantTime(us, update=True)
+    if rtt and self.pending and self.pending[0] == (seq - 1) & 0xFFFF:
+      rtt = rtt / 1000000
+      self.samples.append((rtt, self.pending[1] - rtt / 2))
+      self.rtt = rtt if self.rtt is None else self.rtt + (rtt - self.rtt) / 8
+      self.offset = min(self.samples)[1]
+    self.pending = (seq, forward)
+    return '{}:{}:{}'.format(seq, us, int(rx_time * 1000000) & 0xFFFFFFFF)
+
+# #########################################################
+# Measures the time from an input on the pendant (encoder detent, 
+# button press etc.) to the command being issued to LinuxCNC.
+# Enabled by [MANUALMATIC] TRACE_LATENCY in the ini file.
+# Pendant micros() are mapped to host time by ClockSync.
+class LatencyTracer:
+  REPORT_INTERVAL = 30 # seconds
+  MAX_SAMPLES = 500 # per command
+
+  def __init__(self, clock):
+    self.clock = clock
+    self.samples = {}
+    # Estop is traced on the serial thread, everything else on the command thread
+    self.local = threading.local()
+    self.last_report = time.monotonic()
+
+  # #########################################################
+  # A traced frame has been received
+  def begin(self, cmd, trace, rx_time):
+    self.local.trace = None
+    try:
+      trace_id = int(trace[0:4], 16)
+      input_time = self.clock.toHost(int(trace[4:12], 16))
+    except ValueError:
+      return
+    if input_time is None:
+      return
+    self.local.trace = { 'cmd': cmd[0], 'id': trace_id, 'input': input_time, 
+      'rx': rx_time, 'start': time.monotonic(), 'issued': None }
+
+  # #########################################################
+  # A command has been sent to LinuxCNC (see TracedCommand)
+  def issued(self):
+    t = getattr(self.local, 'trace', None)
+    if t:
+      t['issued'] = time.monotonic()
+
+  # #########################################################
+  # processCmd() has finished with the traced frame
+  def end(self):
+    t = getattr(self.local, 'trace', None)
+    if not t:
+      return
+    self.local.trace = None
+    done = time.monotonic()
+    # Nothing issued (eg setting jog velocity) - time to handled instead
+    issued = t['issued'] or done
+    samples = self.samples.setdefault(t['cmd'], deque(maxlen=self.MAX_SAMPLES))
+    samples.append((t['rx'] - t['input'], done - t['start'], issued - t['input']))
+    if dump_serial_comms:
+      LOG.debug("Trace {:04X} {}: {:.2f}ms".format(t['id'], t['cmd'], (issued - t['input'])*1000))
+
+  def percentile(self, values, p):
+    values = sorted(values)
+    return values[int(round(p * (len(values) - 1)))]
+
+  # #########################################################
+  # Log the distributions per command every REPORT_INTERVAL
+  def report(self):
+    if time.monotonic() - self.last_report < self.REPORT_INTERVAL:
+      return
+    self.last_report = time.monotonic()
+    for cmd, samples in sorted(self.samples.items()):
+      transit = [s[0]*1000 for s in samples]
+      processing = [s[1]*1000 for s in samples]
+      total = [s[2]*1000 for s in samples]
+      LOG.info("Latency {} n={} input-rx p50 {:.2f}ms, processCmd p50 {:.2f}ms, input-issued p50 {:.2f}ms p95 {:.2f}ms max {:.2f}ms".format(
+        cmd, len(samples), self.percentile(transit, 0.5), self.percentile(processing, 0.5),
+        self.percentile(total, 0.5), self.percentile(total, 0.95), max(total)))
+
+# #########################################################
+# Wraps linuxcnc.command() to note when a traced command has been 
+# issued to LinuxCNC - the last call other than wait_complete() wins,
+# eg the jog() after teleop_enable()
+class TracedCommand:
+  def __init__(self, command, tracer):
+    self.command = command
+    self.tracer = tracer
+
+  def __getattr__(self, name):
+    attr = getattr(self.command, name)
+    if not callable(attr) or name == 'wait_complete':
+      return attr
+    def traced(*args, **kwargs):
+      result = attr(*args, **kwargs)
+      self.tracer.issued()
+      return result
+    return traced
+
+# #########################################################
+# Raised by a Job predicate when LinuxCNC has refused the command
+class JobRejected(Exception):
+  pass
+
+# #########################################################
+# A command from the pendant. handleCmd() is a generator that yields
+# (predicate, deadline) whenever it has to wait for LinuxCNC instead 
+# of blocking in wait_complete() or sleep(). The command thread polls
+# stat and resumes it once the predicate is true (see stepJob()).
+class Job:
+  def __init__(self, cmd, payload, steps):
+    self.cmd = cmd
+    self.payload = payload
+    self.steps = steps
+    self.wait = None
+    self.waited = False
+
+# #########################################################
+# Pendant frames where only the newest value matters - spinning an
+# override knob sends far more than LinuxCNC needs. Each cmd has at
+# most one entry waiting for the command thread; a newer frame 
+# replaces the waiting value (or is merged into it, see post()).
+# Rate limited frames (jogs) are admitted to the command queue at up
+# to rate per second, in bursts of up to burst. Until then they wait 
+# here, still coalescing. Serial thread only, apart from take().
+class CommandMailbox:
+  def __init__(self, commands, execute, rate, burst):
+    self.commands = commands
+    self.execute = execute # Queued as (execute, (cmd,))
+    self.rate = rate
+    self.burst = burst
+    self.tokens = burst
+    self.refilled = time.monotonic()
+    self.entries = {} # cmd: (cmd, payload, rx_time)
+    self.deferred = [] # cmds waiting for admission, oldest first
+    self.lock = threading.Lock()
+
+  # Returns False if the command queue is full
+  def post(self, cmd, payload, rx_time, limited=False, merge=None):
+    with self.lock:
+      entry = self.entries.get(cmd)
+      if ( entry is not None ):
+        if ( merge ):
+          payload = merge(entry[1], payload)
+        self.entries[cmd] = (cmd, payload, rx_time)
+        if ( limited or cmd not in self.deferred ):
+          return True # Already on its way
+        self.deferred.remove(cmd) # An unlimited value (a stop) goes now
+      else:
+        self.entries[cmd] = (cmd, payload, rx_time)
+        if ( limited and not self.admit() ):
+          self.deferred.append(cmd)
+          return True
+    return self.queue(cmd)
+
+  # Queue a deferred cmd now, whatever the rate
+  def release(self, cmd):
+    with self.lock:
+      if ( cmd not in self.deferred ):
+        return
+      self.deferred.remove(cmd)
+    self.queue(cmd)
+
+  # Drop waiting entries for which predicate(cmd, payload) is true
+  def cancel(self, predicate):
+    with self.lock:
+      for cmd, payload, rx_time in list(self.entries.values()):
+        if ( predicate(cmd, payload) ):
+          del self.entries[cmd]
+          if ( cmd in self.deferred ):
+            self.deferred.remove(cmd)
+
+  def clear(self):
+    with self.lock:
+      self.entries = {}
+      self.deferred = []
+
+  # Queue deferred cmds as the rate allows
+  def admitDeferred(self):
+    while self.deferred and self.admit():
+      with self.lock:
+        cmd = self.deferred.pop(0)
+      self.queue(cmd)
+
+  # How long until the next deferred cmd can be admitted (seconds),
+  # None if there is nothing deferred
+  def admitTimeout(self):
+    if ( not self.deferred ):
+      return None
+    return max(0, (1 - self.tokens) / self.rate)
+
+  # The newest payload for cmd without taking it, None if cancelled
+  def peek(self, cmd):
+    with self.lock:
+      entry = self.entries.get(cmd)
+    return entry[1] if entry else None
+
+  # The newest value for cmd, None if it was cancelled. Command thread.
+  def take(self, cmd):
+    with self.lock:
+      return self.entries.pop(cmd, None)
+
+  def admit(self):
+    now = time.monotonic()
+    self.tokens = min(self.burst, self.tokens + (now - self.refilled) * self.rate)
+    self.refilled = now
+    if ( self.tokens < 1 ):
+      return False
+    self.tokens -= 1
+    return True
+
+  def queue(self, cmd):
+    try:
+      self.commands.put_nowait((self.execute, (cmd,)))
+      return True
+    except queue.Full:
+      self.take(cmd)
+      return False
+
 class SerialInterface:
   STX = b"\x02"
   ETX = b"\x03"
 
-  RX_STATE_BEGIN=0
-  RX_STATE_COMMAND=1
-
-  def __init__(self, port=None, speed=115200, read_timeout=0.02, connect_retry_time=3):
+  # cmd (2) and payload (max 30)
+  RX_MAX=32
+  # The pendant sends this straight from the estop pin interrupt
+  ESTOP_FRAME = re.compile(b'\x02E1(~[0-9A-F]{12})?\x03')
+  # Frames waiting to be written by the serial thread
+  TX_QUEUE_SIZE=256
+  # While more than this is waiting in the OS buffer for the pendant 
+  # (bytes), state updates are held back and coalesced
+  TX_HIGH_WATER=256
+  # How often held updates are retried (seconds)
+  TX_HOLD_PERIOD=0.005
+
+  # The port is only read when select() says it is readable, so reads
+  # never need to wait
+  def __init__(self, port=None, speed=115200, read_timeout=0, connect_retry_time=3):
     self.owner = None
     self.port = port
     self.speed = speed
     self.read_timeout = read_timeout
     self.connect_retry_time = connect_retry_time
     self.connection = None
+    self.tx_queue = queue.Queue(self.TX_QUEUE_SIZE)
+    self.held = {} # key: frame, latest update for each key (serial thread)
+    self.held_callbacks = []
+    # Wakes the serial thread when something is queued
+    self.wake_r, self.wake_w = os.pipe()
+    os.set_blocking(self.wake_r, False)
+    os.set_blocking(self.wake_w, False)
     self.startConnecting()
-    self.rx_state = self.RX_STATE_BEGIN
-    self.rx_state_count = 0
-    self.rx_buffer = None
+    self.rx_time = 0 # When the last complete frame was received
+    self.rx_pending = bytearray() # Read but not yet processed
 
   # #########################################################
   def setOwner(self, owner):
@@ -126,7 +443,30 @@ class SerialInterface:
     self.retry = 0
     self.connection = None
     self.last_connect_attempt = 0
-    self.rx_state = self.RX_STATE_BEGIN
+    self.rx_pending = bytearray()
+    # Anything queued was for the last connection
+    callbacks = self.held_callbacks
+    self.held = {}
+    self.held_callbacks = []
+    while True:
+      try:
+        data, updates, on_written = self.tx_queue.get_nowait()
+      except queue.Empty:
+        break
+      callbacks.append(on_written)
+    for on_written in callbacks:
+      if on_written:
+        on_written(False)
+
+  # #########################################################
+  # The port's file descriptor for select(), None if not connected
+  def fileno(self):
+    return self.connection.fileno() if self.connection else None
+
+  # #########################################################
+  # Readable when frames have been queued by write()
+  def wakeFd(self):
+    return self.wake_r
 
   def detectTeensy(self):
     if os.path.exists("/dev/serial/by-id"):
@@ -179,122 +519,348 @@ class SerialInterface:
   # #########################################################
   def inputError(self, error):
     self.owner.serialError(error)
-    self.rx_state = self.RX_STATE_BEGIN
-
-  # #########################################################
-  # Feed a single character to the input state machine
-  def processCharacter(self, c):
-    if c == self.STX:
-      if self.rx_state != self.RX_STATE_BEGIN:
-        self.serialError("Possible truncated packet")
-      self.rx_state = self.RX_STATE_COMMAND
-      self.rx_state_count = 0
-      self.rx_buffer = bytearray(22)
-    elif c == self.ETX:
-      if self.rx_state == self.RX_STATE_COMMAND:
-        if self.rx_state_count < 1:
-          self.inputError("Command too short")
+
+  # #########################################################
+  # Read everything waiting on the port and process every complete
+  # frame. Only called when the port is readable so it never blocks.
+  # Returns True if a command was processed.
+  def handleSerialInput(self):
+    if self.connection is None:
+      return False
+    try:
+      # Ask for at least one byte, a readable port with nothing to 
+      # read has gone away and pyserial will raise
+      data = self.connection.read(max(1, self.connection.in_waiting))
+    except (serial.SerialException, OSError) as e:
+      LOG.error("Exception in Manualmatic.readFromSerial() - %s" % (str(e),))
+      self.owner.onDisconnected()
+      self.startConnecting()
+      return False
+    self.rx_pending += data
+    # Nothing new can be complete without an ETX
+    if self.ETX not in data and len(self.rx_pending) <= self.RX_MAX + 2:
+      return False
+    # An estop queued behind other frames is handled first
+    handled = self.dispatchEstop()
+    return self.processFrames() or handled
+
+  # #########################################################
+  # Dispatch every complete STX..ETX frame in the input buffer and 
+  # keep any partial frame at the end for the next read.
+  def processFrames(self):
+    buf = self.rx_pending
+    pos = 0
+    handled = False
+    while True:
+      start = buf.find(self.STX, pos)
+      if start < 0:
+        if pos < len(buf):
+          self.inputError("Unexpected input characters:" + repr(bytes(buf[pos:])))
+        pos = len(buf)
+        break
+      if start > pos:
+        self.inputError("Unexpected input characters:" + repr(bytes(buf[pos:start])))
+      end = buf.find(self.ETX, start + 1)
+      # A frame interrupted by the start of another one
+      next_start = buf.find(self.STX, start + 1, len(buf) if end < 0 else end)
+      if next_start >= 0:
+        self.inputError("Possible truncated packet")
+        pos = next_start
+        continue
+      if end < 0:
+        # Incomplete, wait for the rest unless it is already too long
+        if len(buf) - start - 1 > self.RX_MAX:
+          self.inputError("Command too long")
+          pos = len(buf)
         else:
-          # Note: we're not sending any proper Unicode characters from the
-          # pendant right now, so let's use a simple 8-bit encoding here to
-          # avoid failing on potential illegal multi-byte sequences due
-          # to serial line corruption.
-          data = self.rx_buffer.decode('iso-8859-1')
-          self.owner.processCmd(data[0:2], data[2:].strip('\00'))
-          self.rx_state = self.RX_STATE_BEGIN
-          return True
-      else:
-        self.inputError("Unexpected ETX")
-    elif self.rx_state == self.RX_STATE_COMMAND:
-      if self.rx_state_count >= 22:
+          pos = start
+        break
+      pos = end + 1
+      if end - start - 1 < 1:
+        self.inputError("Command too short")
+      elif end - start - 1 > self.RX_MAX:
         self.inputError("Command too long")
       else:
-        self.rx_buffer[self.rx_state_count] = ord(c)
-        self.rx_state_count += 1
-    elif self.rx_state == self.RX_STATE_BEGIN:
-      self.inputError("Unexpected input character:" + repr(c))
-    else:
-      assert False, "Invalid state: " + str(self.rx_state)
-    return False
+        # Note: we're not sending any proper Unicode characters from the
+        # pendant right now, so let's use a simple 8-bit encoding here to
+        # avoid failing on potential illegal multi-byte sequences due
+        # to serial line corruption.
+        data = buf[start + 1:end].decode('iso-8859-1')
+        self.rx_time = time.monotonic()
+        self.owner.processCmd(data[0:2], data[2:])
+        handled = True
+        if buf is not self.rx_pending: # disconnected by the command
+          return handled
+    del buf[:pos]
+    return handled
 
   # #########################################################
-  # Process all the characters in the input buffer until an input
-  # timout happens.
-  def handleSerialInput(self):
-    while True:
-      if self.connection is None and not self.attemptConnecting():
-        return False
-      try:
-        c = self.connection.read(1)
-        if not c: # timeout
-          return False
-        if self.processCharacter(c): # a command has been executed
-          return True
-      except serial.SerialException as e:
-        LOG.error("Exception in Manualmatic.readFromSerial()", e)
-        self.owner.onDisconnected()
-        self.startConnecting()
-        return False
+  # Handle an estop frame ahead of anything read before it. Frames are
+  # never interleaved by the pendant, so it can simply be cut out.
+  def dispatchEstop(self):
+    m = self.ESTOP_FRAME.search(self.rx_pending)
+    if not m:
+      return False
+    trace = m.group(1).decode('iso-8859-1') if m.group(1) else ''
+    del self.rx_pending[m.start():m.end()]
+    self.rx_time = time.monotonic()
+    self.owner.processCmd('E1', trace)
+    return True
 
-  def writeCommand(self, cmd, payload):
+  # #########################################################
+  # Number of bytes received but not yet processed
+  def pending(self):
+    try:
+      return len(self.rx_pending) + (self.connection.in_waiting if self.connection else 0)
+    except (serial.SerialException, OSError):
+      return len(self.rx_pending)
+
+  def frame(self, cmd, payload):
     if (dump_serial_comms and cmd != 'b '):
       LOG.debug("Outgoing(" + repr(cmd) + ", " + repr(payload) + ")")
-    return self.write(self.STX + cmd.encode() + payload.encode() + self.ETX)
+    return self.STX + cmd.encode() + payload.encode() + self.ETX
+
+  def writeCommand(self, cmd, payload):
+    return self.write(self.frame(cmd, payload))
 
-  def write(self, data):
+  # #########################################################
+  # Queue one or more frames for the serial thread to write. Safe to 
+  # call from any thread. False if not connected or the queue is full.
+  # Otherwise on_written(ok) is called on the serial thread once the
+  # write has succeeded or failed.
+  # updates is an optional {key: frame} of state values that a later
+  # frame for the same key makes stale. While the pendant is slow to 
+  # read they are held back and only the latest for each key is sent.
+  # data is always written straight away.
+  def write(self, data, on_written=None, updates=None):
     if self.connection is None:
       return False
     try:
-      self.connection.write(data)
-      return True
-    except serial.SerialException as se:
-      LOG.error("Exception in Manualmatic.write ToSerial()", str(se))
-      self.owner.onDisconnected()
+      self.tx_queue.put_nowait((data, updates, on_written))
+    except queue.Full:
       return False
+    try:
+      os.write(self.wake_w, b'\0')
+    except BlockingIOError:
+      pass # The serial thread has plenty to wake up for already
+    return True
 
+  # #########################################################
+  # Write everything queued in one go. Serial thread only.
+  def flush(self):
+    try:
+      os.read(self.wake_r, 4096)
+    except BlockingIOError:
+      pass
+    frames = []
+    callbacks = []
+    while True:
+      try:
+        data, updates, on_written = self.tx_queue.get_nowait()
+      except queue.Empty:
+        break
+      if data:
+        frames.append(data)
+      if updates:
+        self.held.update(updates)
+        self.held_callbacks.append(on_written)
+      else:
+        callbacks.append(on_written)
+    if self.held and not self.congested():
+      frames += self.held.values()
+      callbacks += self.held_callbacks
+      self.held = {}
+      self.held_callbacks = []
+    # Anything other than updates is written now, congested or not
+    if not frames and not callbacks:
+      return
+    ok = False
+    if self.connection is not None:
+      try:
+        self.connection.write(b''.join(frames))
+        ok = True
+      except (serial.SerialException, OSError) as e:
+        LOG.error("Exception in Manualmatic.writeToSerial() - %s" % (str(e),))
+        self.owner.onDisconnected()
+        self.disconnect()
+    for on_written in callbacks:
+      if on_written:
+        on_written(ok)
+
+  # #########################################################
+  # The pendant has not read what was last written (it may be busy 
+  # redrawing the screen), so sending it more state would just queue
+  # up stale values
+  def congested(self):
+    try:
+      return self.connection is not None and self.connection.out_waiting > self.TX_HIGH_WATER
+    except (serial.SerialException, OSError):
+      return False
+
+  # #########################################################
+  # How long the serial thread can wait before calling flush() again
+  def flushTimeout(self):
+    return self.TX_HOLD_PERIOD if self.held else None
+
+# #########################################################
+# The frames written during one poll, sent to the serial thread as a
+# single write. Callbacks are told whether that write succeeded.
+class FrameBatch:
+  def __init__(self):
+    self.frames = []
+    self.updates = {} # key: frame, see SerialInterface.write()
+    self.callbacks = []
+
+  def written(self, ok):
+    for callback in self.callbacks:
+      callback(ok)
+
+# #########################################################
+# A value sent to the pendant as cmd + formatted value whenever it
+# changes. field is the name of a linuxcnc.stat attribute or, if it 
+# is not a plain attribute, a function returning the value.
+# If quantum is set the value is rounded to a multiple of it and only
+# sent once it is deadband (at least half a quantum) away from the 
+# rounded value last sent. Noise the pendant can't display, or that 
+# would just flicker the last digit, is not sent.
 class MachineStateValue:
-  def __init__(self, cmd, getter, formatter=format):
+  def __init__(self, cmd, field, formatter=format, quantum=None, deadband=0):
     self.cmd = cmd
-    self.getter = getter
+    self.field = field
     self.formatter = formatter
-    self.last_value = None
-    self.dirty = True
+    self.quantum = quantum
+    self.deadband = deadband
+    self.state = None
+    self.slots = range(0) # Positions in the MachineState snapshot
+  def frames(self):
+    return [(self.cmd, False)]
   def forceRefresh(self):
-    self.dirty = True
-  def update(self, owner):
-    try:
-      current_value = self.getter()
-      if current_value != self.last_value:
-        self.last_value = current_value
-        self.dirty = True
-      if self.dirty:
-        if self.send(owner):
-          self.dirty = False
-    except:
-      print ("Context:", repr(self.cmd))
-      raise
-  def send(self, owner):
-    return owner.writeToSerial(self.cmd, self.formatter(self.last_value))
+    self.state.forceRefresh(self.slots)
 
 # For commands like E or H where the argument is part of the command name
 class MachineStateCommand(MachineStateValue):
-  def send(self, owner):
-    return owner.writeToSerial(self.cmd + self.formatter(self.last_value))
-
-# This must be a function in order to ensure a correct index value
-def machineStateValueForIndex(cmd, getter, formatter, index):
-  return MachineStateValue(cmd + str(index), lambda: getter(index), formatter)
-
-class MachineStateArray:
-  def __init__(self, cmd, indexes, getter, formatter=format):
+  def frames(self):
+    return [(self.cmd, True)]
+
+# One value per axis, sent as cmd + axis index. field is a stat 
+# attribute (or function returning a list) indexed by axis.
+class MachineStateArray(MachineStateValue):
+  def __init__(self, cmd, indexes, field, formatter=format, quantum=None, deadband=0):
+    super().__init__(cmd, field, formatter, quantum, deadband)
     self.indexes = indexes
-    self.values = [ machineStateValueForIndex(cmd, getter, formatter, index) for index in indexes ]
-  def forceRefresh(self):
-    for i in self.values:
-      i.forceRefresh()
+  def frames(self):
+    return [(self.cmd + str(index), False) for index in self.indexes]
+
+# attrgetter()/itemgetter() that always return a tuple
+def tupleGetter(getter, keys):
+  if not keys:
+    return lambda obj: ()
+  if len(keys) == 1:
+    get = getter(keys[0])
+    return lambda obj: (get(obj),)
+  return getter(*keys)
+
+# #########################################################
+# The linuxcnc state sent to the pendant. Each poll, every channel's 
+# stat fields are read into one flat tuple and compared with the last 
+# snapshot in a single comparison. Only the values that changed (or
+# could not be sent last time) are formatted and sent, subject to the
+# channel's quantum and deadband. A value held back by its deadband is
+# sent exactly, if its rounding differs, once it stops changing. A value is only
+# clean once the write it went out in has succeeded, if the write 
+# fails it is marked dirty and sent again on the next poll.
+class MachineState:
+  def __init__(self, channels):
+    fields = [c for c in channels if isinstance(c.field, str) and not isinstance(c, MachineStateArray)]
+    arrays = [c for c in channels if isinstance(c, MachineStateArray)]
+    functions = [c for c in channels if not isinstance(c.field, str) and not isinstance(c, MachineStateArray)]
+    # Snapshot order: plain attributes, arrays, then functions
+    self.frames = [] # (cmd, value is part of cmd, formatter) per slot
+    self.limits = [] # (quantum, deadband) per slot, None if not quantized
+    for c in fields + arrays + functions:
+      start = len(self.frames)
+      self.frames += [(cmd, in_cmd, c.formatter) for cmd, in_cmd in c.frames()]
+      self.limits += [(c.quantum, max(c.deadband, c.quantum / 2)) if c.quantum else None] * (len(self.frames) - start)
+      c.slots = range(start, len(self.frames))
+      c.state = self
+    self.read_fields = tupleGetter(attrgetter, [c.field for c in fields]) if fields else (lambda ls: ())
+    self.read_arrays = [(attrgetter(c.field) if isinstance(c.field, str) else (lambda ls, f=c.field: f()),
+      tupleGetter(itemgetter, c.indexes)) for c in arrays]
+    self.functions = [c.field for c in functions]
+    self.quantized = any(self.limits)
+    self.last = None
+    self.sent = [None] * len(self.frames) # Rounded values last sent
+    self.settling = set() # Slots held back by their deadband
+    self.dirty = set(range(len(self.frames)))
+
+  def forceRefresh(self, slots):
+    self.dirty.update(slots)
+
+  # The changed slots that would make a difference the pendant can show
+  def visible(self, changed, values):
+    limits = self.limits
+    last_sent = self.sent
+    visible = []
+    for i in changed:
+      limit = limits[i]
+      if limit and last_sent[i] is not None and abs(values[i] - last_sent[i]) < limit[1]:
+        continue
+      visible.append(i)
+    return visible
+
+  def snapshot(self, ls):
+    values = self.read_fields(ls)
+    for read, pick in self.read_arrays:
+      values += pick(read(ls))
+    if self.functions:
+      values += tuple([f() for f in self.functions])
+    return values
+
   def update(self, owner):
-    for i in self.values:
-      i.update(owner)
+    values = self.snapshot(owner.ls)
+    last = self.last
+    if values == last and not self.dirty and not self.settling:
+      return
+    self.last = values
+    if last is None:
+      send = range(len(values))
+    else:
+      changed = list(compress(count(), map(ne, values, last)))
+      send = changed
+      if self.quantized:
+        send = self.visible(changed, values)
+        settled = self.settling.difference(changed)
+        self.settling = set(changed).difference(send)
+        if settled:
+          send += [i for i in settled
+            if round(values[i] / self.limits[i][0]) * self.limits[i][0] != self.sent[i]]
+          send.sort()
+    if self.dirty:
+      # forceRefresh() may be called from another thread
+      pending = self.dirty.copy()
+      self.dirty -= pending
+      send = sorted(pending.union(send))
+    frames = self.frames
+    limits = self.limits
+    last_sent = self.sent
+    queued = []
+    for i in send:
+      cmd, in_cmd, formatter = frames[i]
+      value = values[i]
+      if limits[i]:
+        quantum = limits[i][0]
+        value = round(value / quantum) * quantum
+        last_sent[i] = value
+      if in_cmd:
+        sent = owner.writeUpdateToSerial(cmd, cmd + formatter(value))
+      else:
+        sent = owner.writeUpdateToSerial(cmd, cmd, formatter(value))
+      if sent:
+        queued.append(i)
+      else:
+        self.dirty.add(i)
+    if queued:
+      owner.onWritten(lambda ok: ok or self.dirty.update(queued))
 
 # ##########################################################################################
 # start of Manualmatic class definition
@@ -307,22 +873,62 @@ class Manualmatic(Commands):
   PROGRAM_STATE_PAUSED=2
   PROGRAM_STATE_STOPPED=3
 
-  # Heartbeat timeout in seconds
-  HEARTBEAT_MAX=10
+  # Disconnect if no frame has been received for this long (seconds).
+  # The pendant sends a heartbeat whenever it has been quiet for 250ms.
+  LINK_TIMEOUT=1.0
+
+  # Log pendant telemetry as a warning if a loop took longer than this (us)
+  TELEMETRY_STALL_US=50000
+  telemetry = {}
+
+  # Stat polling and reconnect attempts while the pendant is unplugged (seconds)
+  DISCONNECTED_POLL_PERIOD=0.25
+  # How often the serial thread checks the link is alive (seconds)
+  LINK_CHECK_PERIOD=0.1
+  # Frames waiting for the command thread
+  COMMAND_QUEUE_SIZE=64
+  # Settings and jogs where only the newest value matters, see CommandMailbox
+  COALESCED_CMDS = ( Commands.CMD_FEED_OVERRIDE + Commands.CMD_RAPID_OVERRIDE + Commands.CMD_SPINDLE_OVERRIDE
+    + Commands.CMD_SPINDLE_SPEED + Commands.CMD_JOG_VELOCITY 
+    + Commands.CMD_JOG + Commands.CMD_JOG_CONTINUOUS + Commands.CMD_JOG_VECTOR )
+  JOG_CMDS = Commands.CMD_JOG + Commands.CMD_JOG_CONTINUOUS + Commands.CMD_JOG_VECTOR
+  # Waiting jogs are dropped when one of these is received
+  JOG_CANCEL_CMDS = '!' + Commands.CMD_TASK_MODE + Commands.CMD_TASK_STATE
+  # Jogs admitted to the command queue per second and in one burst.
+  # Stops are always admitted.
+  JOG_ADMIT_RATE=50
+  JOG_ADMIT_BURST=5
+  # A command that has not completed in this time is abandoned (seconds),
+  # the same as the default wait_complete() timeout
+  JOB_TIMEOUT=5.0
+  # How often a waiting job checks stat (seconds)
+  JOB_POLL_PERIOD=0.01
+  # How long to wait for the spindle to report it has started before
+  # repeating the start command anyway (seconds)
+  SPINDLE_START_TIMEOUT=0.5
+  # Commands that can run while another waits for LinuxCNC: stops and 
+  # overrides, which never change the mode. Jog and spindle stops are 
+  # picked out by runsAlongside(). Anything else waits its turn,
+  # including CMD_JOG_IDLE which must follow the MPG's last increments.
+  ALONGSIDE_CMDS = ( '!' + Commands.CMD_JOG_STOP
+    + Commands.CMD_FEED_OVERRIDE + Commands.CMD_RAPID_OVERRIDE + Commands.CMD_SPINDLE_OVERRIDE
+    + Commands.CMD_JOG_VELOCITY )
 
   linuxcnc = None
   hal = None #hal
   mmc = None #Component
   ls = None #linuxcnc stat
   lc = None # command
+  lc_link = None # command channel for the serial thread (estop, stopping jogs on disconnect)
   le = None # error
   #gstat = None
   inifile = None
   error = None
   
   running = False
+  worker_error = None # An exception that stopped the poll or command thread
 
-  last_heartbeat = 0
+  last_received = 0 # Any valid frame is proof of life
 
   task_state = None
   interp_state = None
@@ -373,11 +979,51 @@ class Manualmatic(Commands):
   #max_linear_acceleration = 20.0
 
   no_force_homing = 0
+
+  # Stop an MPG jog if the axis is more than this (or the last 
+  # increment) short of its target when the wheel stops (machine units)
+  mpg_overrun_tolerance = 0.5
+  # Commanded MPG jog target and last increment per axis, cleared when
+  # the wheel stops
+  jog_targets = {}
+  jog_increments = {}
+
+  # Log input to command latency ([MANUALMATIC] TRACE_LATENCY)
+  trace_latency = 0
+  tracer = None
+  clock = None
+
+  # linuxcnc.stat is polled at poll_rate_max (Hz) while the machine is
+  # moving or the pendant is in use, dropping to poll_rate_min once it
+  # has been idle for poll_idle_hold seconds 
+  # ([MANUALMATIC] POLL_RATE_MIN, POLL_RATE_MAX and POLL_IDLE_HOLD)
+  poll_rate_min = 4
+  poll_rate_max = 100
+  poll_idle_hold = 1.0
+  last_active = 0 # time.monotonic()
+
+  # Positions and DTG are rounded to the decimal places the pendant
+  # displays and not resent until they are dro_deadband from the 
+  # displayed value (machine units, defaults to 3/4 of the last digit)
+  # or they come to rest
+  # ([MANUALMATIC] DRO_PRECISION and DRO_DEADBAND)
+  dro_precision = 3
+  dro_deadband = None
   
   def __init__(self, _linuxcnc, _hal, _mmc, _serial_intf):
     self.linuxcnc = _linuxcnc
-    self.ls = self.linuxcnc.stat()
+    self.stats = threading.local() # See ls
     self.lc = self.linuxcnc.command()
+    # A separate channel so an estop never waits behind a slow command
+    self.lc_link = self.linuxcnc.command()
+    self.commands = queue.Queue(self.COMMAND_QUEUE_SIZE)
+    self.mailbox = CommandMailbox(self.commands, self.executeLatest, self.JOG_ADMIT_RATE, self.JOG_ADMIT_BURST)
+    # Held by poll() and resetState() which share the sent state
+    self.poll_lock = threading.RLock()
+    # The FrameBatch being filled by poll(), only on the poll thread
+    self.batch = threading.local()
+    # Set by pendant input to bring the next poll forward
+    self.poll_wake = threading.Event()
     self.hal = _hal
     self.mmc = _mmc
     self.serial_intf = _serial_intf
@@ -398,6 +1044,25 @@ class Manualmatic(Commands):
     # return any ini values. Ask me how I know.
     if ( self.inifile ):
       self.readIniFileValues()
+    self.clock = ClockSync()
+    if ( self.trace_latency ):
+      self.tracer = LatencyTracer(self.clock)
+      self.lc = TracedCommand(self.lc, self.tracer)
+      self.lc_link = TracedCommand(self.lc_link, self.tracer)
+
+  # #########################################################
+  # This thread's stat. A stat is not thread safe, so each thread 
+  # polls and reads its own: the poll thread in pollState(), the 
+  # command thread in executeCmd() and while a job waits, and the 
+  # serial thread before anything it reads.
+  @property
+  def ls(self):
+    try:
+      return self.stats.ls
+    except AttributeError:
+      self.stats.ls = self.linuxcnc.stat()
+      self.stats.ls.poll()
+      return self.stats.ls
 
   # #########################################################
   def is_homed(self):
@@ -451,6 +1116,19 @@ class Manualmatic(Commands):
 
       self.spindle_rpm_pin = self.inifile.find('MANUALMATIC', 'SPINDLE_RPM_PIN') or "spindle.0.speed-out"
 
+      self.mpg_overrun_tolerance = float(self.inifile.find('MANUALMATIC', 'MPG_OVERRUN_TOLERANCE') or 0.5)
+
+      self.trace_latency = int(self.inifile.find('MANUALMATIC', 'TRACE_LATENCY') or 0)
+
+      self.poll_rate_max = float(self.inifile.find('MANUALMATIC', 'POLL_RATE_MAX') or 100)
+      self.poll_rate_min = min(float(self.inifile.find('MANUALMATIC', 'POLL_RATE_MIN') or 4), self.poll_rate_max)
+      self.poll_idle_hold = float(self.inifile.find('MANUALMATIC', 'POLL_IDLE_HOLD') or 1.0)
+
+      self.dro_precision = int(self.inifile.find('MANUALMATIC', 'DRO_PRECISION') or 3)
+      self.dro_deadband = self.inifile.find('MANUALMATIC', 'DRO_DEADBAND') or None
+      if ( self.dro_deadband is not None ):
+        self.dro_deadband = float(self.dro_deadband)
+
       self.linear_units = self.inifile.find('TRAJ', 'LINEAR_UNITS') or 'mm'
       self.angular_units = self.inifile.find('TRAJ', 'ANGULAR_UNITS') or 'degree'
       
@@ -488,6 +1166,7 @@ class Manualmatic(Commands):
     self.writeIniValueToSerial(self.INI_DEFAULT_LINEAR_VELOCITY, self.default_linear_velocity)
     self.writeIniValueToSerial(self.INI_MAX_LINEAR_VELOCITY, self.max_linear_velocity)
     self.writeIniValueToSerial(self.INI_NO_FORCE_HOMING, self.no_force_homing)
+    self.writeIniValueToSerial(self.INI_TRACE_LATENCY, self.trace_latency)
     self.writeToSerial(self.CMD_INI_VALUE+self.INI_COMPLETE)
 
 
@@ -501,6 +1180,13 @@ class Manualmatic(Commands):
     LOG.info('INI_MAX_SPINDLE_SPEED = {}'.format(self.max_spindle_speed))
     LOG.info('INI_SPINDLE_INCREMENT = {}'.format(self.spindle_increment))
     LOG.info('INI_SPINDLE_RPM_PIN = {}'.format(self.spindle_rpm_pin))
+    LOG.info('INI_MPG_OVERRUN_TOLERANCE = {}'.format(self.mpg_overrun_tolerance))
+    LOG.info('INI_TRACE_LATENCY = {}'.format(self.trace_latency))
+    LOG.info('INI_POLL_RATE_MIN = {}'.format(self.poll_rate_min))
+    LOG.info('INI_POLL_RATE_MAX = {}'.format(self.poll_rate_max))
+    LOG.info('INI_POLL_IDLE_HOLD = {}'.format(self.poll_idle_hold))
+    LOG.info('INI_DRO_PRECISION = {}'.format(self.dro_precision))
+    LOG.info('INI_DRO_DEADBAND = {}'.format(self.dro_deadband))
     LOG.info('INI_LINEAR_UNITS = {}'.format(self.linear_units))
     LOG.info('INI_ANGULAR_UNITS = {}'.format(self.angular_units))
     LOG.info('INI_DEFAULT_LINEAR_VELOCITY = {}'.format(self.default_linear_velocity))
@@ -576,17 +1262,48 @@ class Manualmatic(Commands):
     self.writeToSerial(Commands.CMD_INI_VALUE + key, format(value))
 
   # #########################################################
-  # Write a message to the serial port
+  # Queue a message for the serial port. Returns False if it could 
+  # not be queued (not connected or the queue is full) - a 
+  # MachineStateValue will try again on the next poll.
+  # During poll() messages are added to the poll's FrameBatch instead.
   def writeToSerial(self, cmd, payload=""):
     #LOG.debug(cmd)
     #LOG.debug(payload)
     #Pad cmd if required
     if len(cmd) == 1:
       cmd = cmd + ' '
-    if not self.serial_intf.writeCommand(cmd, payload):
-      self.serial_intf.disconnect()
-      return False
-    return True
+    batch = getattr(self.batch, 'current', None)
+    if batch is not None:
+      if self.serial_intf.connection is None:
+        return False
+      batch.frames.append(self.serial_intf.frame(cmd, payload))
+      return True
+    return self.serial_intf.writeCommand(cmd, payload)
+
+  # #########################################################
+  # Send a state value that supersedes any earlier one with the same
+  # key. During poll() it may be held back while the pendant is slow to
+  # read and dropped if a newer value for the key comes along.
+  def writeUpdateToSerial(self, key, cmd, payload=""):
+    if len(cmd) == 1:
+      cmd = cmd + ' '
+    batch = getattr(self.batch, 'current', None)
+    if batch is not None:
+      if self.serial_intf.connection is None:
+        return False
+      batch.updates[key] = self.serial_intf.frame(cmd, payload)
+      return True
+    return self.serial_intf.writeCommand(cmd, payload)
+
+  # #########################################################
+  # Call callback(ok) once the messages written so far have been 
+  # written to the port (or have failed to be)
+  def onWritten(self, callback):
+    batch = getattr(self.batch, 'current', None)
+    if batch is not None:
+      batch.callbacks.append(callback)
+    else:
+      callback(True) # Outside poll() there is nothing to wait for
   
   def serialError(self, error):
     print ("Serial error:", error)
@@ -601,6 +1318,10 @@ class Manualmatic(Commands):
   # #########################################################
   # Initialise or reset the state of the pendant
   def resetState(self):
+    with self.poll_lock:
+      self.sendState()
+
+  def sendState(self):
     self.writeToSerial(self.CMD_TASK_STATE + format(self.ls.task_state))
     self.task_state = self.ls.task_state
     self.axes = 0
@@ -610,40 +1331,59 @@ class Manualmatic(Commands):
         self.axes_list.append(i)
         self.axes +=1
     self.sendIniValues()
+    # Only send position changes the pendant would show
+    dro_quantum = 10 ** -self.dro_precision
+    dro_deadband = dro_quantum * 0.75 if self.dro_deadband is None else self.dro_deadband
     # Store these for later use
-    self.g5x_index =  MachineStateCommand(Commands.CMD_G5X_INDEX, lambda: self.ls.g5x_index)
-    self.g5x_values = MachineStateArray(Commands.CMD_G5X_OFFSET, self.axes_list, lambda i: self.ls.g5x_offset[i], formatter=fmtround5)
-    self.g92_values = MachineStateArray(Commands.CMD_G92_OFFSET, self.axes_list, lambda i: self.ls.g92_offset[i], formatter=fmtround5)
-    self.tool_values = MachineStateArray(Commands.CMD_TOOL_OFFSET, self.axes_list, lambda i: self.ls.tool_offset[i], formatter=fmtround5)
-    self.absolute_pos_values = MachineStateArray(Commands.CMD_ABSOLUTE_POS, self.axes_list, lambda i: self.ls.actual_position[i], formatter=fmtround5)
-    self.on_state_values = [
+    self.g5x_index =  MachineStateCommand(Commands.CMD_G5X_INDEX, 'g5x_index')
+    self.g5x_values = MachineStateArray(Commands.CMD_G5X_OFFSET, self.axes_list, 'g5x_offset', formatter=fmtround5)
+    self.g92_values = MachineStateArray(Commands.CMD_G92_OFFSET, self.axes_list, 'g92_offset', formatter=fmtround5)
+    self.tool_values = MachineStateArray(Commands.CMD_TOOL_OFFSET, self.axes_list, 'tool_offset', formatter=fmtround5)
+    self.absolute_pos_values = MachineStateArray(Commands.CMD_ABSOLUTE_POS, self.axes_list, 'actual_position', formatter=fmtround5,
+      quantum=dro_quantum, deadband=dro_deadband)
+    self.on_state_values = MachineState([
       self.g5x_index,
       self.g5x_values,
       self.g92_values,
       self.tool_values,
       self.absolute_pos_values,
-      MachineStateArray(Commands.CMD_DTG, self.axes_list, lambda i: self.ls.dtg[i], formatter=fmtround5),
+      MachineStateArray(Commands.CMD_DTG, self.axes_list, 'dtg', formatter=fmtround5,
+        quantum=dro_quantum, deadband=dro_deadband),
       MachineStateValue(Commands.CMD_SPINDLE_OVERRIDE, lambda: self.ls.spindle[0]["override"]),
       #MachineStateValue(Commands.CMD_SPINDLE_RPM, lambda: self.ls.spindle[0]["speed"]),
       MachineStateValue(Commands.CMD_SPINDLE_DIRECTION, lambda: self.ls.spindle[0]["direction"]),
-      MachineStateValue(Commands.CMD_FEED_OVERRIDE, lambda: self.ls.feedrate),
-      MachineStateValue(Commands.CMD_RAPID_OVERRIDE, lambda: self.ls.rapidrate),
-      MachineStateCommand(Commands.CMD_TASK_MODE, lambda: self.ls.task_mode),
-      MachineStateArray(Commands.CMD_HOMED, self.axes_list, lambda i: self.ls.homed[i]),
+      MachineStateValue(Commands.CMD_FEED_OVERRIDE, 'feedrate'),
+      MachineStateValue(Commands.CMD_RAPID_OVERRIDE, 'rapidrate'),
+      MachineStateCommand(Commands.CMD_TASK_MODE, 'task_mode'),
+      MachineStateArray(Commands.CMD_HOMED, self.axes_list, 'homed'),
       MachineStateCommand(Commands.CMD_ALL_HOMED, lambda: 1 if self.is_homed() else 0),
-      MachineStateValue(Commands.CMD_INTERP_STATE, lambda: self.ls.interp_state),
-      MachineStateValue(Commands.CMD_CURRENT_VEL, lambda: self.ls.current_vel),
-      MachineStateCommand(Commands.CMD_MOTION_TYPE, lambda: self.ls.motion_type),
-      MachineStateCommand(Commands.CMD_FLOOD, lambda: self.ls.flood),
-      MachineStateCommand(Commands.CMD_MIST, lambda: self.ls.mist),
-    ]
+      MachineStateValue(Commands.CMD_INTERP_STATE, 'interp_state'),
+      # Displayed in whole units per minute
+      MachineStateValue(Commands.CMD_CURRENT_VEL, 'current_vel', quantum=1/60),
+      MachineStateCommand(Commands.CMD_MOTION_TYPE, 'motion_type'),
+      MachineStateCommand(Commands.CMD_FLOOD, 'flood'),
+      MachineStateCommand(Commands.CMD_MIST, 'mist'),
+    ])
     self.writeToSerial(self.CMD_JOG_VELOCITY, format(self.jog_velocity))
 
   # #########################################################
   # Called every pollRate seconds to compare the current linuxcnc
   # state with sent state and write changes to the serial port
   # #TODO Investigate https://www.linuxcnc.org/docs/html/gui/GStat.html
+  # Everything the poll sends goes to the serial thread as one write.
   def poll(self):
+    with self.poll_lock:
+      batch = FrameBatch()
+      self.batch.current = batch
+      try:
+        self.pollState()
+      finally:
+        self.batch.current = None
+      if ( (batch.frames or batch.updates) 
+          and not self.serial_intf.write(b''.join(batch.frames), batch.written, batch.updates) ):
+        batch.written(False)
+
+  def pollState(self):
     # update linuxcnc state
     self.ls.poll()
     
@@ -665,7 +1405,7 @@ class Manualmatic(Commands):
       #LOG.debug("Calculated RPM: " + format(rpm))
       #LOG.debug("self.hal.get_value(spindle.0.speed-out: " + str(self.hal.get_value("spindle.0.speed-out")) )
       #if ( speed_out != 0 ):
-      self.writeToSerial(self.CMD_SPINDLE_RPM, format(speed_out))
+      self.writeUpdateToSerial(self.CMD_SPINDLE_RPM, self.CMD_SPINDLE_RPM, format(speed_out))
       self.spindle_speed_out = speed_out
     
     
@@ -679,8 +1419,7 @@ class Manualmatic(Commands):
     # Skip anything that is not required when machine is not on
     if ( self.ls.task_state == self.linuxcnc.STATE_ON ):
 
-      for value in self.on_state_values:
-        value.update(self)
+      self.on_state_values.update(self)
 
 
       # state ######################
@@ -698,8 +1437,182 @@ class Manualmatic(Commands):
 
 
   # #########################################################
-  # Called if a valid message is received
+  # Called on the serial thread when a valid message is received.
+  # Estop and heartbeats are handled straight away, everything else
+  # is queued for the command thread so a command waiting for 
+  # LinuxCNC never holds up the link.
   def processCmd(self, cmd, payload):
+    self.last_received = time.time()
+    rx_time = self.serial_intf.rx_time
+    if ( cmd[0] != self.CMD_HEARTBEAT and cmd[0] != self.CMD_TELEMETRY ):
+      self.last_active = time.monotonic()
+      self.poll_wake.set()
+    stop_axes = self.jogStopAxes(cmd, payload)
+    if ( stop_axes ):
+      # Nothing waiting for the axes should start after they have stopped
+      self.mailbox.cancel(lambda c, p: self.isWaitingJog(c, p) and not stop_axes.isdisjoint(self.jogAxes(c, p)))
+    elif ( cmd[0] in self.JOG_CANCEL_CMDS ):
+      # ...or after an abort, estop or mode change
+      self.mailbox.cancel(self.isWaitingJog)
+    elif ( cmd[0] == self.CMD_SPINDLE_SPEED and self.isSpindleStop(payload) ):
+      # Queued afresh, so it runs alongside a waiting start (see runsAlongside())
+      self.mailbox.cancel(lambda c, p: c[0] == self.CMD_SPINDLE_SPEED)
+    if ( cmd == self.CMD_TASK_STATE + str(self.linuxcnc.STATE_ESTOP) or cmd[0] == self.CMD_HEARTBEAT ):
+      self.executeCmd(cmd, payload, rx_time) # Never waits
+      return
+    if ( cmd[0] in self.COALESCED_CMDS ):
+      if ( not self.postCmd(cmd, payload, rx_time) ):
+        LOG.warning("Command queue full, dropped " + repr(cmd))
+      return
+    if ( cmd[0] == self.CMD_JOG_IDLE ):
+      # The MPG's last increments must be jogged before it is checked
+      self.mailbox.release(self.CMD_JOG + cmd[1])
+    try:
+      self.commands.put_nowait((self.executeCmd, (cmd, payload, rx_time)))
+    except queue.Full:
+      LOG.warning("Command queue full, dropped " + repr(cmd))
+
+  # #########################################################
+  # Leave a setting or jog in the mailbox. Jogs are rate limited, 
+  # except stops, and MPG increments add up while they wait.
+  def postCmd(self, cmd, payload, rx_time):
+    if ( cmd[0] in self.JOG_CMDS ):
+      merge = self.addIncrements if cmd[0] == self.CMD_JOG else None
+      return self.mailbox.post(cmd, payload, rx_time, not self.isJogStop(cmd, payload), merge)
+    return self.mailbox.post(cmd, payload, rx_time)
+
+  # Run the newest value posted for cmd
+  def executeLatest(self, cmd):
+    entry = self.mailbox.take(cmd)
+    if ( entry is None ):
+      return None
+    return self.executeCmd(*entry)
+
+  # Two waiting MPG increments for the same axis as one, keeping the
+  # latest latency trace
+  def addIncrements(self, waiting, payload):
+    total = float(waiting.split(self.TRACE_SEPARATOR, 1)[0])
+    increment, sep, trace = payload.partition(self.TRACE_SEPARATOR)
+    return format(total + float(increment)) + sep + trace
+
+  # The axes a waiting jog will move
+  def jogAxes(self, cmd, payload):
+    try:
+      if ( cmd[0] == self.CMD_JOG_VECTOR ):
+        return (int(cmd[1]), int(payload.split(',', 1)[0]))
+      return (int(cmd[1]),)
+    except ValueError:
+      return ()
+
+  # The axes a stop (n, or N or V to zero velocity) stops, empty if
+  # cmd is not a stop
+  def jogStopAxes(self, cmd, payload):
+    if ( cmd[0] == self.CMD_JOG_STOP and cmd[1].isdigit() ):
+      return {int(cmd[1])}
+    if ( cmd[0] in (self.CMD_JOG_CONTINUOUS, self.CMD_JOG_VECTOR) and self.isJogStop(cmd, payload) ):
+      return set(self.jogAxes(cmd, payload))
+    return set()
+
+  # A spindle speed of zero. Anything that won't parse is let through
+  # for handleCmd() to reject.
+  def isSpindleStop(self, payload):
+    try:
+      return float(payload.split(self.TRACE_SEPARATOR, 1)[0]) == 0
+    except ValueError:
+      return True
+
+  # A waiting jog that would move an axis. Waiting stops are kept.
+  def isWaitingJog(self, cmd, payload):
+    return cmd[0] in self.JOG_CMDS and not self.isJogStop(cmd, payload)
+
+  # A continuous or vector jog to zero velocity. Anything that won't 
+  # parse is let through for handleCmd() to reject.
+  def isJogStop(self, cmd, payload):
+    payload = payload.split(self.TRACE_SEPARATOR, 1)[0]
+    try:
+      if ( cmd[0] == self.CMD_JOG_CONTINUOUS ):
+        return float(payload) == 0
+      if ( cmd[0] == self.CMD_JOG_VECTOR ):
+        axis2, vel1, vel2 = payload.split(',')
+        return float(vel1) == 0 and float(vel2) == 0
+    except ValueError:
+      return True
+    return False
+
+  # #########################################################
+  # Strip any latency trace and run the command until it has to wait
+  # for LinuxCNC. Returns the Job if it is waiting.
+  def executeCmd(self, cmd, payload, rx_time):
+    trace = None
+    if ( self.TRACE_SEPARATOR in payload ):
+      payload, trace = payload.split(self.TRACE_SEPARATOR, 1)
+    self.ls.poll()
+    job = Job(cmd, payload, self.handleCmd(cmd, payload, rx_time))
+    if ( self.tracer and trace ):
+      self.tracer.begin(cmd, trace, rx_time)
+      job = self.stepJob(job)
+      self.tracer.end()
+      return job
+    return self.stepJob(job)
+
+  # #########################################################
+  # Run a job until it has to wait. Returns the job while it is
+  # waiting, None once it has finished.
+  def stepJob(self, job):
+    try:
+      while True:
+        if ( job.wait ):
+          predicate, deadline, optional = job.wait
+          self.ls.poll()
+          if ( not predicate() ):
+            if ( time.monotonic() < deadline ):
+              return job
+            if ( optional ):
+              job.wait = None
+              continue
+            job.steps.close()
+            LOG.warning("Timed out waiting for LinuxCNC: " + repr(job.cmd))
+            return self.endJob(job, self.JOB_TIMED_OUT)
+        job.wait = next(job.steps)
+        job.waited = True
+    except StopIteration:
+      return self.endJob(job, self.JOB_OK)
+    except JobRejected:
+      job.steps.close()
+      LOG.warning("Rejected by LinuxCNC: " + repr(job.cmd))
+      return self.endJob(job, self.JOB_REJECTED)
+
+  # #########################################################
+  # Tell the pendant how a command that had to wait turned out. 
+  # Anything that fails is reported, even if it didn't wait.
+  def endJob(self, job, result):
+    if ( result != self.JOB_OK or job.waited ):
+      self.writeToSerial(self.CMD_JOB_RESULT + result, job.cmd)
+    return None
+
+  # #########################################################
+  # Wait (yield) until predicate() is true. If optional, carry on 
+  # after the timeout rather than abandon the command.
+  def until(self, predicate, timeout=None, optional=False):
+    return (predicate, time.monotonic() + (timeout or self.JOB_TIMEOUT), optional)
+
+  # #########################################################
+  # Wait (yield) for LinuxCNC to finish the last command issued. What
+  # wait_complete() does, without blocking the command thread.
+  def completion(self, timeout=None):
+    serial = self.lc.serial
+    def complete():
+      if ( self.ls.echo_serial_number < serial ):
+        return False
+      if ( self.ls.state == self.linuxcnc.RCS_ERROR ):
+        raise JobRejected()
+      return self.ls.state != self.linuxcnc.RCS_EXEC
+    return self.until(complete, timeout)
+
+  # #########################################################
+  # Called by the command thread to run the command (it is a generator,
+  # see Job) - wait for LinuxCNC with yield, not wait_complete()
+  def handleCmd(self, cmd, payload, rx_time):
     if (dump_serial_comms and cmd != 'b '):
       LOG.debug("Incoming(" + repr(cmd) + ", " + repr(payload) + ")")
 
@@ -710,17 +1623,17 @@ class Manualmatic(Commands):
 
     # Heartbeat
     elif ( cmd[0] == self.CMD_HEARTBEAT ):
-      self.last_heartbeat = time.time()
       #LOG.debug("<B...");
-      #Bounce it right back
-      self.writeToSerial(self.CMD_HEARTBEAT)
+      #Bounce it right back, with our timestamp
+      self.writeToSerial(self.CMD_HEARTBEAT, self.clock.onHeartbeat(payload, rx_time) or "")
 
     # Jog
     elif ( cmd[0] == self.CMD_JOG_STOP and self.ls.axis_mask & (1<<int(cmd[1])) ):
       #LOG.debug("Jog Stop: " + self.axesMap[int(cmd[1])])
       if (self.ls.motion_mode != self.linuxcnc.TRAJ_MODE_TELEOP):
         self.lc.teleop_enable(True)
-        self.lc.wait_complete()
+        yield self.completion()
+      self.jog_targets.pop(int(cmd[1]), None)
       try:
         self.lc.jog(self.linuxcnc.JOG_STOP, False, int(cmd[1]))
       except:
@@ -728,17 +1641,30 @@ class Manualmatic(Commands):
     elif ( cmd[0] == self.CMD_JOG and self.ls.axis_mask & (1<<int(cmd[1])) ):
       if (self.ls.motion_mode != self.linuxcnc.TRAJ_MODE_TELEOP):
         self.lc.teleop_enable(True)
-        self.lc.wait_complete()
+        yield self.completion()
       try:
         self.lc.jog(self.linuxcnc.JOG_INCREMENT, False, int(cmd[1]), (self.jog_velocity/60), float(payload))
+        # Increments accumulate in LinuxCNC, so keep track of where the axis is heading
+        axis = int(cmd[1])
+        self.jog_targets[axis] = self.jog_targets.get(axis, self.ls.actual_position[axis]) + float(payload)
+        self.jog_increments[axis] = abs(float(payload))
       except:
         None
 
+    # Two axis (vector) jog
+    elif ( cmd[0] == self.CMD_JOG_VECTOR and self.ls.axis_mask & (1<<int(cmd[1])) ):
+      yield from self.jogVector(int(cmd[1]), payload)
+
+    # MPG has stopped turning
+    elif ( cmd[0] == self.CMD_JOG_IDLE and self.ls.axis_mask & (1<<int(cmd[1])) ):
+      self.onJogIdle(int(cmd[1]))
+
     elif ( cmd[0] == self.CMD_JOG_CONTINUOUS and self.ls.axis_mask & (1<<int(cmd[1])) ):
       #LOG.debug("Jog Continuous: " + self.axesMap[int(cmd[1])])
       if (self.ls.motion_mode != self.linuxcnc.TRAJ_MODE_TELEOP):
         self.lc.teleop_enable(True)
-        self.lc.wait_complete()
+        yield self.completion()
+      self.jog_targets.pop(int(cmd[1]), None)
       try:
         if ( float(payload) == 0 ):
           self.lc.jog(self.linuxcnc.JOG_STOP, False, int(cmd[1]))
@@ -747,7 +1673,7 @@ class Manualmatic(Commands):
       except:
         None
 
-    # Turn on or off
+    # Turn on or off (or estop)
     elif ( cmd[0] == self.CMD_TASK_STATE and '1234'.find(cmd[1]) != -1 ):
       if ( (self.ls.task_state == self.linuxcnc.STATE_ESTOP_RESET
       or self.ls.task_state == self.linuxcnc.STATE_OFF )
@@ -760,10 +1686,7 @@ class Manualmatic(Commands):
         LOG.info("Turning machine off")
         self.lc.state(self.linuxcnc.STATE_OFF)
       if (int(cmd[1]) == self.linuxcnc.STATE_ESTOP ):
-        LOG.info("ESTOP")
-        #Set the hal pin
-        self.mmc['estop-is-activated'] = 1
-        self.lc.state(self.linuxcnc.STATE_ESTOP) # Shouldn't be necessary unless estop_latch is not comfigured
+        self.onEstop()
       if (int(cmd[1]) == self.linuxcnc.STATE_ESTOP_RESET ):
         LOG.info("ESTOP_RESET")
         #Set the hal pin 
@@ -794,7 +1717,8 @@ class Manualmatic(Commands):
         if ( self.ls.spindle[0]["direction"] == 0 ):
           #Hit it twice or it'll start at gmoccapy default!!!
           self.lc.spindle(self.linuxcnc.SPINDLE_FORWARD, float(rpm), 0)
-          time.sleep(0.12)
+          yield self.completion()
+          yield self.until(lambda: self.ls.spindle[0]["direction"] != 0, self.SPINDLE_START_TIMEOUT, optional=True)
         self.lc.spindle(self.linuxcnc.SPINDLE_FORWARD, float(rpm), 0)
       elif ( rpm < 0 ):
         # Never allow spindle over speed
@@ -803,7 +1727,8 @@ class Manualmatic(Commands):
         if ( self.ls.spindle[0]["direction"] == 0 ):
           #Hit it twice or it'll start at gmoccapy default!!!
           self.lc.spindle(self.linuxcnc.SPINDLE_REVERSE, abs(rpm), 0)
-          time.sleep(0.12)
+          yield self.completion()
+          yield self.until(lambda: self.ls.spindle[0]["direction"] != 0, self.SPINDLE_START_TIMEOUT, optional=True)
         self.lc.spindle(self.linuxcnc.SPINDLE_REVERSE, abs(rpm), 0)
       else:
         self.lc.spindle(self.linuxcnc.SPINDLE_OFF, 0)
@@ -813,7 +1738,7 @@ class Manualmatic(Commands):
       #@TODO check current task_mode
       if ( self.ls.spindle[0]["override_enabled"] == 0):
         self.lc.set_spindle_override(1, 0)
-        self.lc.wait_complete()
+        yield self.completion()
       incr = float(payload)
       #LOG.debug("set spindle override: " + str(incr) )
       self.lc.spindleoverride(incr, 0)
@@ -822,7 +1747,7 @@ class Manualmatic(Commands):
     elif ( cmd[0] == self.CMD_FEED_OVERRIDE ):
         if ( self.ls.feed_override_enabled == 0):
           self.lc.set_feed_override(1)
-          self.lc.wait_complete()
+          yield self.completion()
         incr = float(payload)
         self.lc.feedrate(incr)
 
@@ -843,7 +1768,7 @@ class Manualmatic(Commands):
     elif ( cmd[0] == self.CMD_G5X_OFFSET and self.ls.axis_mask & (1<<int(cmd[1])) ):
       if ( self.ok_for_mdi() ):
           self.lc.mode(self.linuxcnc.MODE_MDI)
-          self.lc.wait_complete()
+          yield self.completion()
           i = int(cmd[1])
           # have to round offset or we may get an 'e' within format'd string
           offset = round(float(payload), 5)
@@ -853,12 +1778,17 @@ class Manualmatic(Commands):
           # Using L20 rather than L2 calculates based on G90 or 91
           # http://linuxcnc.org/docs/html/gcode/g-code.html#gcode:g10-l20
           mdi_cmd = 'G10 L20 P0 ' + self.axesMap[i] + format(offset)
-          self.lc.mdi(mdi_cmd)
-          self.lc.wait_complete()
-          self.lc.mode(self.linuxcnc.MODE_MANUAL)
-          self.lc.wait_complete()
+          try:
+            self.lc.mdi(mdi_cmd)
+            yield self.completion()
+          finally:
+            # Back to manual even if the G10 was rejected or timed out
+            self.lc.mode(self.linuxcnc.MODE_MANUAL)
+          yield self.completion()
           # must resend *all* offset and absolute positions
           self.resend_positions()
+      else:
+        raise JobRejected()
 
     # Flood
     elif ( cmd[0] == self.CMD_FLOOD ):
@@ -881,48 +1811,308 @@ class Manualmatic(Commands):
 
 
 
+    # Telemetry
+    elif ( cmd[0] == self.CMD_TELEMETRY ):
+      if ( cmd[1] == self.TELEMETRY_COMPLETE ):
+        self.logTelemetry()
+      else:
+        self.telemetry[cmd[1]] = payload
+
     # Debug
     elif ( cmd == 'DD' ):
       LOG.debug('Debug: ' + payload )
 
 
+  # #########################################################
+  # Estop - the hal pin is set before anything else
+  def onEstop(self):
+    #Set the hal pin
+    self.mmc['estop-is-activated'] = 1
+    self.lc_link.state(self.linuxcnc.STATE_ESTOP) # Shouldn't be necessary unless estop_latch is not comfigured
+    LOG.info("ESTOP")
+
+  # #########################################################
+  # Jog two axes with no wait in between so they start (and stop)
+  # in the same servo cycle as near as we can and diagonal moves
+  # stay straight. payload is "axis2,velocity1,velocity2" (per minute)
+  def jogVector(self, axis1, payload):
+    try:
+      axis2, vel1, vel2 = payload.split(',')
+      axis2 = int(axis2)
+      vel1 = float(vel1)
+      vel2 = float(vel2)
+    except ValueError:
+      LOG.warning("Invalid vector jog: " + repr(payload))
+      return
+    if ( not self.ls.axis_mask & (1<<axis2) ):
+      return
+    if (self.ls.motion_mode != self.linuxcnc.TRAJ_MODE_TELEOP):
+      self.lc.teleop_enable(True)
+      yield self.completion()
+    self.jog_targets.pop(axis1, None)
+    self.jog_targets.pop(axis2, None)
+    try:
+      for axis, vel in ((axis1, vel1), (axis2, vel2)):
+        if ( vel == 0 ):
+          self.lc.jog(self.linuxcnc.JOG_STOP, False, axis)
+        else:
+          self.lc.jog(self.linuxcnc.JOG_CONTINUOUS, False, axis, vel/60)
+    except:
+      None
+
+  # #########################################################
+  # The MPG has stopped turning. If the axis still has further to go 
+  # than the tolerance (a fast spin queues many increments), stop it
+  # rather than let it carry on after the operator has stopped. The
+  # last increment may still be in progress (a single click of a 
+  # coarse increment at a slow jog velocity), so that is never stopped.
+  def onJogIdle(self, axis):
+    target = self.jog_targets.pop(axis, None)
+    increment = self.jog_increments.pop(axis, 0)
+    if ( target is None ):
+      return
+    self.ls.poll()
+    remaining = abs(target - self.ls.actual_position[axis])
+    if ( remaining > max(self.mpg_overrun_tolerance, increment) ):
+      LOG.debug("MPG stopped " + format(round(remaining, 4)) + " short on " + self.axesMap[axis] + ", stopping jog")
+      try:
+        self.lc.jog(self.linuxcnc.JOG_STOP, False, axis)
+      except:
+        None
+
+  # #########################################################
+  # The pendant reports its loop timing every few seconds.
+  # Only worth a warning if it has stalled.
+  def logTelemetry(self):
+    t = self.telemetry
+    self.telemetry = {}
+    rtt = 'n/a' if self.clock.rtt is None else '{:.0f}us'.format(self.clock.rtt * 1000000)
+    msg = ('Pendant loops: {} max: {}us p99: {}us avg: {}us display overruns: {} rx backlog: {} heartbeat rtt: {}'
+      + ' latest task: {}us longest task: {}us missed periods: {}').format(
+      t.get(self.TELEMETRY_LOOPS), t.get(self.TELEMETRY_MAX), t.get(self.TELEMETRY_P99), t.get(self.TELEMETRY_AVG), 
+      t.get(self.TELEMETRY_DISPLAY_OVERRUNS), t.get(self.TELEMETRY_RX_BACKLOG), rtt,
+      t.get(self.TELEMETRY_TASK_LATE), t.get(self.TELEMETRY_TASK_RUN), t.get(self.TELEMETRY_TASK_MISSED))
+    try:
+      stalled = ( int(t.get(self.TELEMETRY_MAX, 0)) > self.TELEMETRY_STALL_US 
+        or int(t.get(self.TELEMETRY_DISPLAY_OVERRUNS, 0)) > 0 
+        or int(t.get(self.TELEMETRY_RX_BACKLOG, 0)) > 0 )
+    except ValueError:
+      stalled = True
+    if ( stalled ):
+      LOG.warning(msg)
+    else:
+      LOG.debug(msg)
+
+  # A pulled cable is caught straight away by a SerialException, this
+  # catches a pendant that has stopped talking. Frames still waiting to 
+  # be read (we may have been busy) count as proof of life.
   def checkHeartbeat(self):
-    if self.last_heartbeat > 0 and self.last_heartbeat + self.HEARTBEAT_MAX < time.time():
+    if ( self.last_received > 0 and self.last_received + self.LINK_TIMEOUT < time.time()
+        and not self.serial_intf.pending() ):
       LOG.warning("no heartbeat, stopping...")
+      # A hung pendant may have been jogging, stop as a pulled cable does
+      self.onDisconnected()
       self.serial_intf.disconnect()
 
   # #########################################################
   # Called on successful opening of the serial port
   def onConnected(self):
-    self.last_heartbeat = 0
+    self.last_received = time.time()
+    self.jog_targets = {}
+    self.jog_increments = {}
+    self.clock.reset()
     #Start the heartbeat
     self.writeToSerial(self.CMD_HEARTBEAT)
+    self.ls.poll()
     self.resetState()
 
   # #########################################################
-  # Called on when the serial port has been disconnected
+  # Called on when the serial port has been disconnected, or the 
+  # pendant has stopped talking (see checkHeartbeat())
   def onDisconnected(self):
+    self.mailbox.clear()
+    self.jog_targets = {}
+    self.jog_increments = {}
+    self.ls.poll()
     # @TODO Do not send jog stop if machine is off
     if ( self.ls.task_state == self.linuxcnc.STATE_ON and self.ls.motion_mode == self.linuxcnc.TRAJ_MODE_TELEOP ):
       #LOG.debug("stop jog on disconnect")
       for axis in self.axes_list:
-        self.lc.jog(self.linuxcnc.JOG_STOP, False, axis)
+        self.lc_link.jog(self.linuxcnc.JOG_STOP, False, axis)
 
   # #########################################################
-  # Run the loop to check incoming serial data and
-  # linuxcnc state every pollRate seconds
-  # Possibly provide two different update rates? Do we need
-  # to poll state as often as listen to the serial port?
-  # poll every nth read? or rather, read every pollRate/nth
+  # The serial thread. Waits on the serial port and the outgoing 
+  # queue: frames are read and dispatched (see processCmd()) as soon
+  # as they arrive and queued frames are written as soon as they are
+  # queued. The link is checked every LINK_CHECK_PERIOD.
   def run(self):
+    selector = selectors.DefaultSelector()
+    selector.register(self.serial_intf.wakeFd(), selectors.EVENT_READ)
+    connection = None
+    fd = None
+    next_check = time.monotonic()
     while self.running:
-      self.serial_intf.handleSerialInput()
+      # (Re)register the port whenever it has been opened or closed.
+      # A closed fd has already left the selector but may be reused
+      # by the next connection, so don't compare fds.
+      if ( connection is not self.serial_intf.connection ):
+        if ( fd is not None ):
+          selector.unregister(fd)
+          fd = None
+        connection = self.serial_intf.connection
+        if ( connection is not None ):
+          fd = self.serial_intf.fileno()
+          selector.register(fd, selectors.EVENT_READ)
+
+      timeout = max(0, next_check - time.monotonic())
+      for wait in (self.serial_intf.flushTimeout(), self.mailbox.admitTimeout()):
+        if ( wait is not None ):
+          timeout = min(timeout, wait)
+      for key, events in selector.select(timeout):
+        if ( key.fd == fd ):
+          self.serial_intf.handleSerialInput()
+      self.mailbox.admitDeferred()
+      self.serial_intf.flush()
+
+      now = time.monotonic()
+      if ( now < next_check ):
+        continue
       if self.serial_intf.connection:
         self.checkHeartbeat()
+        next_check = now + self.LINK_CHECK_PERIOD
+      else:
+        self.serial_intf.attemptConnecting()
+        next_check = now + self.DISCONNECTED_POLL_PERIOD
+    selector.close()
+    if ( self.worker_error ):
+      raise self.worker_error
+
+  # #########################################################
+  # Anything that means the readouts are about to change
+  def isActive(self):
+    return ( self.ls.current_vel > 0 
+      or self.ls.interp_state != self.linuxcnc.INTERP_IDLE
+      or self.jog_targets )
+
+  # #########################################################
+  # The stat poll thread. Compares linuxcnc state with the sent state
+  # and queues the changes for the serial thread, however long the 
+  # command thread is busy for. Polls at poll_rate_max while active
+  # (or the pendant has just sent something) and poll_rate_min
+  # when idle.
+  def runPoll(self):
+    last_poll = 0
+    next_poll = time.monotonic()
+    while self.running:
+      now = time.monotonic()
+      if ( now < next_poll ):
+        if ( self.poll_wake.wait(next_poll - now) ):
+          self.poll_wake.clear()
+          next_poll = min(next_poll, last_poll + 1.0 / self.poll_rate_max)
+        continue
+      last_poll = now
+      if self.serial_intf.connection:
         self.poll()
+        if ( self.tracer ):
+          self.tracer.report()
+        if ( self.isActive() ):
+          self.last_active = now
+        if ( now - self.last_active < self.poll_idle_hold ):
+          period = 1.0 / self.poll_rate_max
+        else:
+          period = 1.0 / self.poll_rate_min
       else:
         self.ls.poll()
-        time.sleep(0.25)
+        period = self.DISCONNECTED_POLL_PERIOD
+      # Don't try to catch up after a stall, just carry on
+      next_poll = max(next_poll + period, now)
+
+  # #########################################################
+  # The command thread. Runs the queued commands from the pendant
+  # in the order they were received, the next one starting when the
+  # last has finished waiting for LinuxCNC.
+  # While a job waits for LinuxCNC, stops and overrides still run
+  # (see runsAlongside()), anything else is held until it is done.
+  def runCommands(self):
+    jobs = [] # Waiting for LinuxCNC
+    held = deque() # Commands waiting for jobs to finish
+    next_step = 0
+    while self.running:
+      if ( not jobs and held ):
+        handler, args = held.popleft()
+        job = handler(*args)
+        if ( job ):
+          jobs.append(job)
+        continue
+      try:
+        timeout = max(0, next_step - time.monotonic()) if jobs else 0.25
+        handler, args = self.commands.get(timeout=timeout)
+        payload = args[1] if len(args) > 1 else self.mailbox.peek(args[0])
+        if ( not jobs or self.runsAlongside(args[0], payload) ):
+          jobs = self.cancelJobs(jobs, args[0], payload)
+          job = handler(*args)
+          if ( job ):
+            jobs.append(job)
+        elif ( len(held) < self.COMMAND_QUEUE_SIZE ):
+          held.append((handler, args))
+        else:
+          LOG.warning("Command queue full, dropped " + repr(args[0]))
+      except queue.Empty:
+        pass
+      if ( jobs and time.monotonic() >= next_step ):
+        jobs = [job for job in [self.stepJob(job) for job in jobs] if job]
+        next_step = time.monotonic() + self.JOB_POLL_PERIOD
+
+  # Can cmd run while another command is waiting for LinuxCNC
+  def runsAlongside(self, cmd, payload):
+    if ( cmd[0] in self.ALONGSIDE_CMDS ):
+      return True
+    if ( payload is None ):
+      return True # Cancelled, nothing to run
+    if ( cmd[0] in (self.CMD_JOG_CONTINUOUS, self.CMD_JOG_VECTOR) ):
+      return self.isJogStop(cmd, payload)
+    if ( cmd[0] == self.CMD_SPINDLE_SPEED ):
+      return self.isSpindleStop(payload)
+    return False
+
+  # Drop the waiting jobs a stop makes pointless: an abort drops 
+  # everything, a spindle stop a spindle start and a jog stop any jog
+  # waiting to move its axes. No result is sent, it was superseded.
+  def cancelJobs(self, jobs, cmd, payload):
+    if ( payload is None ):
+      return jobs
+    if ( cmd[0] == '!' ):
+      cancel = lambda job: True
+    elif ( cmd[0] == self.CMD_SPINDLE_SPEED and self.isSpindleStop(payload) ):
+      cancel = lambda job: job.cmd[0] == self.CMD_SPINDLE_SPEED
+    else:
+      axes = self.jogStopAxes(cmd, payload)
+      if ( not axes ):
+        return jobs
+      cancel = lambda job: job.cmd[0] in self.JOG_CMDS and not axes.isdisjoint(self.jogAxes(job.cmd, job.payload))
+    kept = []
+    for job in jobs:
+      if ( cancel(job) ):
+        job.steps.close()
+        LOG.debug("Cancelled by " + repr(cmd) + ": " + repr(job.cmd))
+      else:
+        kept.append(job)
+    return kept
+
+  # #########################################################
+  # Any exception stops the component, as it did before the work was
+  # split across threads
+  def runWorker(self, target):
+    try:
+      target()
+    except Exception as e:
+      LOG.error("Exception in Manualmatic." + target.__name__ + "() - " + str(e))
+      self.worker_error = e
+      self.running = False
+
+  def startWorkers(self):
+    for target in (self.runPoll, self.runCommands):
+      threading.Thread(target=self.runWorker, args=[target], name=target.__name__, daemon=True).start()
 
   def isRunning(self):
     return self.running
@@ -935,18 +2125,22 @@ class Manualmatic(Commands):
 
 
   # #########################################################
-  # Start running in the current thread
+  # Start the poll and command threads and run the serial loop 
+  # in the current thread
   def start(self):
     LOG.info("Starting Manualmatic...")
     self.running = True
+    self.startWorkers()
     self.run()
 
   # #########################################################
-  # Start running in a new thread - not sure this is necessary
+  # Start running in new threads - not sure this is necessary
   # in the context of a user space component. Currently not used.
   def init(self, pollRate=0.04):    
-    statusThread = threading.Thread(target=self.run, args=[pollRate])
+    self.poll_rate_max = 1.0 / pollRate
     self.running = True
+    self.startWorkers()
+    statusThread = threading.Thread(target=self.run)
     #statusThread.daemon = True
     statusThread.start()
     #statusThread.join()